@@ -8,12 +8,15 @@
 #include <random>
 
 #include "exceptions.h"
+#include "parallel.h"
+#include "array_buffer.h"
+#include "array_shape.h"
+#include "array_span.h"
 
 // ReSharper disable CppNonExplicitConvertingConstructor
 
 namespace chloro
 {
-    using ArrayShape = std::vector<size_t>;
     using DefaultableArrayShape = std::vector<int64_t>;
     inline static const ArrayShape scalar_shape{ 1 };
 
@@ -27,10 +30,10 @@ namespace chloro
     template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
     class Array final
     {
-        friend class Array;
+        template <typename, typename> friend class Array;
     private:
         // Data members
-        std::vector<T> data_;
+        ArrayBuffer<T> data_;
         ArrayShape shape_;
 
         // Internal implementations
@@ -39,11 +42,39 @@ namespace chloro
             if (data_.size() != other.data_.size())
                 throw MismatchedSizesException("Sizes of the two arrays don't match");
         }
+        static T pairwise_sum(const T* data, const size_t size)
+        {
+            constexpr size_t block = 128;
+            if (size <= block)
+            {
+                // Independent partial sums let the compiler vectorize the loop
+                T partial[4]{};
+                size_t i = 0;
+                for (; i + 4 <= size; i += 4)
+                    for (size_t j = 0; j < 4; j++)
+                        partial[j] += data[i + j];
+                for (; i < size; i++) partial[0] += data[i];
+                return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+            }
+            const size_t half = size / 2;
+            return pairwise_sum(data, half) + pairwise_sum(data + half, size - half);
+        }
+        // Calls function(outer_index, inner_begin, inner_end) for every outer slice, parallelizing
+        // on the outer slices, or on the inner range if there is only one outer slice
+        template <typename Func>
+        static void parallel_axis_for(const size_t outer, const size_t length, const size_t inner, Func&& function)
+        {
+            if (outer == 1)
+                parallel_for(inner, length, [&](const size_t begin, const size_t end) { function(0, begin, end); });
+            else
+                parallel_for(outer, length * inner, [&](const size_t begin, const size_t end)
+                    { for (size_t i = begin; i < end; i++) function(i, 0, inner); });
+        }
 
     public:
         // Constructors
 
-        Array() :data_(0), shape_{ 0 } {} /**< \brief Default constructs an empty array with no space for data. */
+        Array() :shape_{ 0 } {} /**< \brief Default constructs an empty array with no space for data. */
         Array(const Array&) = default; /**< \brief Copy constructor. */
         Array(Array&&) = default; /**< \brief Move constructor. */
         Array(const T value) :data_{ value }, shape_{ 1 } {} /**< \brief Construct an \c Array of shape 1 with a given value. */
@@ -59,9 +90,12 @@ namespace chloro
                     shape_ = list.shape_;
                 else if (shape_ != list.shape_)
                     throw MismatchedSizesException("Shapes of the initializer lists don't match");
-                data_.insert(data_.end(), list.data_.begin(), list.data_.end());
                 first = false;
             }
+            const size_t list_size = lists.size() == 0 ? 0 : lists.begin()->size();
+            data_ = ArrayBuffer<T>(lists.size() * list_size);
+            T* iter = data_.begin();
+            for (const Array& list : lists) iter = std::copy(list.data_.begin(), list.data_.end(), iter);
             shape_.insert(shape_.begin(), lists.size());
         }
         /** \brief Implicit converting constructor from an array of a different data type. */
@@ -76,10 +110,10 @@ namespace chloro
         /** \brief Constructs an array filled with zeros with the given shape. */
         static Array zeros(const ArrayShape& shape)
         {
-            size_t size = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies());
+            const size_t size = shape.element_count();
             Array result;
             result.shape_ = shape;
-            result.data_.resize(size);
+            result.data_ = ArrayBuffer<T>(size);
             return result;
         }
         /**
@@ -90,11 +124,11 @@ namespace chloro
         {
             static std::mt19937 generator{ std::random_device{}() };
             std::normal_distribution distribution{ mean, stddev };
-            size_t size = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies());
+            const size_t size = shape.element_count();
             Array result;
             result.shape_ = shape;
-            result.data_.reserve(size);
-            for (size_t i = 0; i < size; i++) result.data_.push_back(distribution(generator));
+            result.data_ = ArrayBuffer<T>(size);
+            for (T& value : result.data_) value = distribution(generator);
             return result;
         }
         /**
@@ -105,10 +139,27 @@ namespace chloro
          */
         static Array repeats(const T repeat, const ArrayShape& shape)
         {
-            size_t size = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies());
+            const size_t size = shape.element_count();
             Array result;
             result.shape_ = shape;
-            result.data_ = std::vector<T>(size, repeat);
+            result.data_ = ArrayBuffer<T>(size, repeat);
+            return result;
+        }
+        /**
+         * \brief Constructs an array viewing memory owned by others, without copying the values.
+         * \details Operations on the view read and write the viewed memory directly. Copying the
+         * view results in an array owning a copy of the values.
+         * \param data Pointer to the viewed memory.
+         * \param shape The shape of the array.
+         * \return The constructed view.
+         * \remark The viewed memory should outlive the view.
+         */
+        static Array view(T* data, const ArrayShape& shape)
+        {
+            const size_t size = shape.element_count();
+            Array result;
+            result.shape_ = shape;
+            result.data_ = ArrayBuffer<T>::view(data, size);
             return result;
         }
 
@@ -121,7 +172,7 @@ namespace chloro
         Array& operator=(const std::vector<T>& data)
         {
             if (data.size() == data_.size())
-                data_ = data;
+                data_.assign(data.begin(), data.end());
             else
                 throw MismatchedSizesException("Size of the vector doesn't match that of the array");
             return *this;
@@ -130,11 +181,21 @@ namespace chloro
         Array& operator=(std::vector<T>&& data)
         {
             if (data.size() == data_.size())
-                data_ = std::move(data);
+                data_.assign(data.begin(), data.end());
             else
                 throw MismatchedSizesException("Size of the vector doesn't match that of the array");
             return *this;
         }
+        /**
+         * \brief Copy the values of another array of the same size into the existing storage of this
+         * array, which keeps views bound to the viewed memory.
+         */
+        Array& assign(const Array& other)
+        {
+            check_size_match(other);
+            data_.assign(other.data_.begin(), other.data_.end());
+            return *this;
+        }
 
         // Properties
 
@@ -153,8 +214,18 @@ namespace chloro
 
         // Accessors
 
-        /** \brief Get a read only \c std::vector containing the values in the array. */
-        const std::vector<T>& data() const { return data_; }
+        /** \brief Get a read only buffer containing the values in the array. */
+        const ArrayBuffer<T>& data() const { return data_; }
+        /** \brief Check whether this array is a view of memory owned by others. */
+        bool is_view() const { return data_.is_view(); }
+        /**
+         * \brief Get a span of the values, for writing them with external kernels.
+         * \details Unless the array is a view, the values are aligned to \c ArrayAllocator::alignment bytes.
+         * The span is invalidated by anything reallocating the array, like assigning or force reshaping.
+         */
+        ArraySpan<T> span() { return { data_.data(), data_.size() }; }
+        /** \brief Get a read only span of the values. */
+        ArraySpan<const T> span() const { return { data_.data(), data_.size() }; }
         /** \brief Get a reference to the value at the given index. */
         T& at(const std::initializer_list<size_t>& list) // Specify the index by an initializer_list
         {
@@ -372,9 +443,7 @@ namespace chloro
         /** \brief Clear all the values to default value of \c T. */
         void clear()
         {
-            const size_t size = data_.size();
-            data_.clear();
-            data_.resize(size);
+            std::fill(data_.begin(), data_.end(), T{});
         }
         /**
          * \brief Reshape the array to a different shape. You can use auto calculation (-1 for the
@@ -415,7 +484,7 @@ namespace chloro
             {
                 if (data_size % size != 0)
                     throw IllegalArgumentException("Automatic dimension is not an integer");
-                shape_[size_t(automatic)] = data_size / size;
+                shape_.set(size_t(automatic), data_size / size);
             }
         }
         /** \brief Force reshaping the array into another shape. Padding and truncating might happen. */
@@ -466,12 +535,130 @@ namespace chloro
             return std::accumulate(data_.begin(), data_.end(), initial, function);
         }
 
+        // Reductions
+
+        /**
+         * \brief Calculates the sum of all the values in the array.
+         * \details Uses blocked pairwise summation, which is faster and numerically more stable than
+         * sequential accumulation, and splits the work among threads for large arrays.
+         */
+        T sum() const
+        {
+            const size_t size = data_.size();
+            const size_t chunks = std::min(thread_count(), std::max(size / parallel_grain, size_t(1)));
+            if (chunks <= 1) return pairwise_sum(data_.data(), size);
+            std::vector<T> partial(chunks);
+            const size_t chunk_size = (size + chunks - 1) / chunks;
+            parallel_for(chunks, chunk_size, [&](const size_t begin, const size_t end)
+                {
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        const size_t offset = i * chunk_size;
+                        partial[i] = pairwise_sum(data_.data() + offset, std::min(chunk_size, size - offset));
+                    }
+                });
+            return pairwise_sum(partial.data(), chunks);
+        }
+        /**
+         * \brief Calculates the sum of the values along an axis.
+         * \param axis The axis to reduce.
+         * \return The result array, whose shape is the same as this array except that the reduced
+         * axis is removed. Reducing a 1D array results in an array of shape { 1 }.
+         */
+        Array sum(const size_t axis) const
+        {
+            const auto [outer, length, inner] = detail::split_at_axis(shape_, axis);
+            Array result = zeros(detail::reduced_shape(shape_, axis));
+            if (inner == 1)
+            {
+                parallel_for(outer, length, [&](const size_t begin, const size_t end)
+                    {
+                        for (size_t i = begin; i < end; i++)
+                            result.data_[i] = pairwise_sum(data_.data() + i * length, length);
+                    });
+                return result;
+            }
+            parallel_axis_for(outer, length, inner, [&](const size_t i, const size_t begin, const size_t end)
+                {
+                    T* out = result.data_.data() + i * inner;
+                    for (size_t j = 0; j < length; j++)
+                    {
+                        const T* in = data_.data() + (i * length + j) * inner;
+                        for (size_t k = begin; k < end; k++) out[k] += in[k];
+                    }
+                });
+            return result;
+        }
+        /**
+         * \brief Calculates the arithmetic mean of the values along an axis.
+         * \param axis The axis to reduce.
+         * \return The result array, whose shape is the same as this array except that the reduced
+         * axis is removed.
+         */
+        Array mean(const size_t axis) const
+        {
+            const size_t length = length_at(axis);
+            Array result = sum(axis);
+            return result /= T(length);
+        }
+        /**
+         * \brief Finds the maximum values along an axis.
+         * \param axis The axis to reduce.
+         * \return The result array, whose shape is the same as this array except that the reduced
+         * axis is removed.
+         */
+        Array max(const size_t axis) const
+        {
+            const auto [outer, length, inner] = detail::split_at_axis(shape_, axis);
+            Array result = zeros(detail::reduced_shape(shape_, axis));
+            parallel_axis_for(outer, length, inner, [&](const size_t i, const size_t begin, const size_t end)
+                {
+                    T* out = result.data_.data() + i * inner;
+                    const T* first = data_.data() + i * length * inner;
+                    for (size_t k = begin; k < end; k++) out[k] = first[k];
+                    for (size_t j = 1; j < length; j++)
+                    {
+                        const T* in = first + j * inner;
+                        for (size_t k = begin; k < end; k++) out[k] = in[k] > out[k] ? in[k] : out[k];
+                    }
+                });
+            return result;
+        }
+        /**
+         * \brief Finds the indices of the maximum values along an axis.
+         * \details If the maximum value appears multiple times, the first index is chosen.
+         * \param axis The axis to reduce.
+         * \return The result array of indices, whose shape is the same as this array except that the
+         * reduced axis is removed.
+         */
+        Array<size_t> argmax(const size_t axis) const
+        {
+            const auto [outer, length, inner] = detail::split_at_axis(shape_, axis);
+            Array<size_t> result = Array<size_t>::zeros(detail::reduced_shape(shape_, axis));
+            parallel_axis_for(outer, length, inner, [&](const size_t i, const size_t begin, const size_t end)
+                {
+                    size_t* out = result.data_.data() + i * inner;
+                    const T* first = data_.data() + i * length * inner;
+                    for (size_t k = begin; k < end; k++)
+                    {
+                        T max = first[k];
+                        for (size_t j = 1; j < length; j++)
+                            if (first[j * inner + k] > max)
+                            {
+                                max = first[j * inner + k];
+                                out[k] = j;
+                            }
+                    }
+                });
+            return result;
+        }
+
         // Stream output
 
         /** \brief Output an array into an \c std::ostream. */
         friend std::ostream& operator<<(std::ostream& stream, const Array& array)
         {
-            std::vector<size_t> periods(array.shape_);
+            std::vector<size_t> periods(array.shape_.begin(), array.shape_.end());
             std::reverse(periods.begin(), periods.end());
             std::partial_sum(periods.begin(), periods.end(), periods.begin(), std::multiplies<size_t>());
             const size_t size = array.size();
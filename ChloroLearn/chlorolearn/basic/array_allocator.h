@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace chloro
+{
+    /**
+     * \brief Policy providing the memory of arrays, see \c ArrayBuffer.
+     * \details Every allocation is aligned to at least \c alignment bytes, so kernels may use aligned vector
+     * loads on the values of arrays which are not views. Arrays remember the allocator of their memory, so
+     * an allocator must outlive every array allocated from it.
+     * \details The allocator used for new arrays is the one of the innermost \c AllocatorScope of the thread,
+     * or the process wide default set by \c set_default, which is \c aligned initially.
+     */
+    class ArrayAllocator
+    {
+    private:
+        static std::atomic<ArrayAllocator*>& default_storage();
+        static ArrayAllocator*& scoped_storage()
+        {
+            thread_local ArrayAllocator* scoped = nullptr;
+            return scoped;
+        }
+    public:
+        /** \brief Alignment of every allocation, a cache line. */
+        static constexpr size_t alignment = 64;
+        virtual ~ArrayAllocator() noexcept = default; /**< \brief Destructor. */
+        /**
+         * \brief Allocate uninitialized memory aligned to at least \c alignment bytes.
+         * \param bytes Size of the allocation, which is not zero.
+         * \return Pointer to the allocated memory.
+         */
+        virtual void* allocate(size_t bytes) = 0;
+        /** \brief Free memory returned by \c allocate of the same size. */
+        virtual void deallocate(void* data, size_t bytes) noexcept = 0;
+
+        /** \brief Get the allocator for new arrays on the current thread. */
+        static ArrayAllocator& current()
+        {
+            ArrayAllocator* scoped = scoped_storage();
+            return scoped ? *scoped : *default_storage().load(std::memory_order_acquire);
+        }
+        /** \brief Set the allocator used by threads without an \c AllocatorScope. */
+        static void set_default(ArrayAllocator& allocator)
+        {
+            default_storage().store(&allocator, std::memory_order_release);
+        }
+        /** \brief Get the allocator of plain cache line aligned heap memory. */
+        static ArrayAllocator& aligned();
+        /** \brief Get an allocator using transparent huge pages for buffers of at least 2 MiB. */
+        static ArrayAllocator& huge_pages();
+
+        friend class AllocatorScope;
+    };
+
+    /** \brief Allocates cache line aligned memory from the heap. */
+    class AlignedAllocator final : public ArrayAllocator
+    {
+    public:
+        void* allocate(const size_t bytes) override
+        {
+            return ::operator new[](bytes, std::align_val_t(alignment));
+        }
+        void deallocate(void* data, const size_t) noexcept override
+        {
+            ::operator delete[](data, std::align_val_t(alignment));
+        }
+    };
+
+    /**
+     * \brief Allocates large buffers aligned to huge pages, and asks the kernel to back them with transparent
+     * huge pages, which saves TLB misses on sweeps over large arrays. Smaller buffers are cache line aligned.
+     * \remark Huge pages are only requested on Linux, and only take effect when they are enabled in the
+     * \c madvise or \c always mode of the system.
+     */
+    class HugePageAllocator final : public ArrayAllocator
+    {
+    private:
+        size_t threshold_;
+    public:
+        /** \brief Size of a huge page on common platforms. */
+        static constexpr size_t page_size = size_t(2) << 20;
+        /** \brief Constructs an allocator using huge pages for buffers of at least \a threshold bytes. */
+        explicit HugePageAllocator(const size_t threshold = page_size) :threshold_(threshold) {}
+        void* allocate(const size_t bytes) override
+        {
+            if (bytes < threshold_) return ::operator new[](bytes, std::align_val_t(alignment));
+            const size_t rounded = (bytes + page_size - 1) / page_size * page_size;
+            void* data = ::operator new[](rounded, std::align_val_t(page_size));
+#ifdef __linux__
+            madvise(data, rounded, MADV_HUGEPAGE); // Only a hint, failing is harmless
+#endif
+            return data;
+        }
+        void deallocate(void* data, const size_t bytes) noexcept override
+        {
+            if (bytes < threshold_)
+                ::operator delete[](data, std::align_val_t(alignment));
+            else
+                ::operator delete[](data, std::align_val_t(page_size));
+        }
+    };
+
+    inline ArrayAllocator& ArrayAllocator::aligned()
+    {
+        static AlignedAllocator allocator;
+        return allocator;
+    }
+
+    inline ArrayAllocator& ArrayAllocator::huge_pages()
+    {
+        static HugePageAllocator allocator;
+        return allocator;
+    }
+
+    inline std::atomic<ArrayAllocator*>& ArrayAllocator::default_storage()
+    {
+        static std::atomic<ArrayAllocator*> allocator{ &aligned() };
+        return allocator;
+    }
+
+    /**
+     * \brief Makes arrays allocated on the current thread use an allocator, until the scope is destroyed.
+     * Scopes can be nested, the innermost one takes effect. Arenas (see \c ArenaScope) take precedence.
+     * \remark Worker threads of the parallel kernels use the default allocator.
+     */
+    class AllocatorScope final
+    {
+    private:
+        ArrayAllocator* previous_;
+    public:
+        /** \brief Enter a scope. */
+        explicit AllocatorScope(ArrayAllocator& allocator) :previous_(ArrayAllocator::scoped_storage())
+        {
+            ArrayAllocator::scoped_storage() = &allocator;
+        }
+        AllocatorScope(const AllocatorScope&) = delete;
+        AllocatorScope& operator=(const AllocatorScope&) = delete;
+        ~AllocatorScope() noexcept { ArrayAllocator::scoped_storage() = previous_; } /**< \brief Leave the scope. */
+    };
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "array_allocator.h"
+#include "memory_tracker.h"
+
+namespace chloro
+{
+    /**
+     * \brief A bump allocator for short-lived array storage, like the temporaries of back propagation.
+     * \details Arrays allocated while an arena is current on the thread (see \c ArenaScope) draw their memory
+     * from the arena instead of the heap, and releasing them costs nothing. All the memory is reclaimed at
+     * once by \c reset, after which the arrays allocated from the arena must not be used anymore.
+     * \details Memory comes from blocks of the current \c ArrayAllocator, which are counted by the
+     * \c MemoryTracker as a whole. When a step needed more than one block, \c reset replaces them with a
+     * single block large enough for the whole step, so that a steady training loop allocates nothing after
+     * its first step.
+     * \remark An arena is used by a single thread. Worker threads of the parallel kernels don't see the arena
+     * of the thread which spawned them, and allocate from their \c ArrayAllocator as usual.
+     */
+    class ArrayArena final
+    {
+    public:
+        /** \brief Alignment of every allocation, a cache line. */
+        static constexpr size_t alignment = ArrayAllocator::alignment;
+    private:
+        struct Block
+        {
+            std::byte* data;
+            size_t size;
+            uint32_t memory_tag;
+            ArrayAllocator* allocator;
+        };
+        std::vector<Block> blocks_;
+        size_t block_size_;
+        MemoryCategory category_;
+        size_t block_ = 0; // Index of the block allocated from
+        size_t offset_ = 0; // Offset of the free memory in that block
+        size_t used_ = 0; // Bytes allocated since the last reset, including the unused ends of blocks
+        size_t peak_ = 0;
+        static ArrayArena*& current_storage()
+        {
+            thread_local ArrayArena* current = nullptr;
+            return current;
+        }
+        void add_block(const size_t size)
+        {
+            const MemoryScope scope(category_);
+            ArrayAllocator& allocator = ArrayAllocator::current();
+            std::byte* data = static_cast<std::byte*>(allocator.allocate(size));
+            blocks_.push_back({ data, size, MemoryTracker::allocated(size), &allocator });
+        }
+        void free_blocks() noexcept
+        {
+            for (const Block& block : blocks_)
+            {
+                MemoryTracker::released(block.memory_tag, block.size);
+                block.allocator->deallocate(block.data, block.size);
+            }
+            blocks_.clear();
+        }
+    public:
+        /**
+         * \brief Constructs an arena, which allocates no memory until it's used.
+         * \param block_size Size of the blocks in bytes. Allocations larger than a block get their own block.
+         * \param category Memory category the blocks are counted in, they're not attributed to any owner.
+         */
+        explicit ArrayArena(const size_t block_size = size_t(1) << 20,
+            const MemoryCategory category = MemoryCategory::other) :block_size_(block_size), category_(category) {}
+        ArrayArena(const ArrayArena&) = delete;
+        ArrayArena& operator=(const ArrayArena&) = delete;
+        ~ArrayArena() noexcept { free_blocks(); } /**< \brief Frees the blocks. */
+
+        /** \brief Get the arena of the current thread, \c nullptr if there's none. */
+        static ArrayArena* current() { return current_storage(); }
+
+        /**
+         * \brief Allocate memory aligned to \c alignment bytes.
+         * \param bytes Size of the allocation.
+         * \return Pointer to the allocated memory, valid until the next \c reset.
+         */
+        void* allocate(size_t bytes)
+        {
+            bytes = (std::max(bytes, size_t(1)) + alignment - 1) / alignment * alignment;
+            while (block_ < blocks_.size() && offset_ + bytes > blocks_[block_].size)
+            {
+                used_ += blocks_[block_].size - offset_;
+                block_++;
+                offset_ = 0;
+            }
+            if (block_ == blocks_.size()) add_block(std::max(bytes, block_size_));
+            void* result = blocks_[block_].data + offset_;
+            offset_ += bytes;
+            used_ += bytes;
+            peak_ = std::max(peak_, used_);
+            return result;
+        }
+
+        /** \brief Reclaim all the allocations, and merge the blocks into one if more than one was used. */
+        void reset()
+        {
+            if (block_ > 0)
+            {
+                // Blocks are used in order, so the step fits into the blocks up to the current one
+                size_t size = 0;
+                for (size_t i = 0; i <= block_; i++) size += blocks_[i].size;
+                free_blocks();
+                add_block(size);
+            }
+            block_ = 0;
+            offset_ = 0;
+            used_ = 0;
+        }
+
+        /** \brief Free all the blocks. */
+        void release()
+        {
+            free_blocks();
+            block_ = 0;
+            offset_ = 0;
+            used_ = 0;
+        }
+
+        /** \brief Get the total size of the blocks in bytes. */
+        size_t capacity() const
+        {
+            size_t size = 0;
+            for (const Block& block : blocks_) size += block.size;
+            return size;
+        }
+        /** \brief Get the bytes allocated since the last reset. */
+        size_t used() const { return used_; }
+        /** \brief Get the maximum bytes allocated between two resets. */
+        size_t peak() const { return peak_; }
+
+        friend class ArenaScope;
+    };
+
+    /**
+     * \brief Makes arrays allocated on the current thread draw from an arena, until the scope is destroyed.
+     * Scopes can be nested, the innermost one takes effect, and a scope of \c nullptr suspends the arena.
+     */
+    class ArenaScope final
+    {
+    private:
+        ArrayArena* previous_;
+    public:
+        /** \brief Enter a scope. */
+        explicit ArenaScope(ArrayArena* arena) :previous_(ArrayArena::current_storage())
+        {
+            ArrayArena::current_storage() = arena;
+        }
+        ArenaScope(const ArenaScope&) = delete;
+        ArenaScope& operator=(const ArenaScope&) = delete;
+        ~ArenaScope() noexcept { ArrayArena::current_storage() = previous_; } /**< \brief Leave the scope. */
+    };
+}
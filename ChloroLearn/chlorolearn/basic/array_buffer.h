@@ -0,0 +1,197 @@
+#pragma once
+
+#include <initializer_list>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <type_traits>
+
+#include "array_allocator.h"
+#include "array_arena.h"
+#include "exceptions.h"
+#include "memory_tracker.h"
+
+namespace chloro
+{
+    /**
+     * \brief Contiguous storage of the values of an \c Array.
+     * \details A buffer either owns its memory, or is a view of memory owned by someone else, like
+     * a slice of a larger buffer. Copying a buffer always results in an owning buffer, while moving
+     * a view results in another view of the same memory. Assigning to a buffer replaces its contents
+     * like a \c std::vector, use \c assign for writing values through a view. Owned memory is counted by
+     * the \c MemoryTracker.
+     * \details Owned memory of trivial types comes from the current \c ArrayAllocator, and is aligned to
+     * \c ArrayAllocator::alignment bytes. It's drawn from the \c ArrayArena of the current thread instead if
+     * there is one. Such a buffer behaves like any owning buffer, but must not be used after the arena is
+     * reset. Views are only as aligned as the memory they view.
+     * \tparam T Type of the stored values.
+     */
+    template <typename T>
+    class ArrayBuffer final
+    {
+    private:
+        enum class Storage : uint8_t
+        {
+            owned, // Allocated from the heap, and freed by this buffer
+            view, // Owned by others
+            arena // Allocated from an arena, and reclaimed when it's reset
+        };
+        T* data_ = nullptr;
+        size_t size_ = 0;
+        Storage storage_ = Storage::owned;
+        uint32_t memory_tag_ = 0;
+        ArrayAllocator* allocator_ = nullptr; // Allocator of owned memory of trivial types
+        void release()
+        {
+            if (storage_ == Storage::owned && data_)
+            {
+                MemoryTracker::released(memory_tag_, size_ * sizeof(T));
+                if constexpr (std::is_trivial_v<T>)
+                    allocator_->deallocate(data_, size_ * sizeof(T));
+                else
+                    delete[] data_;
+            }
+            data_ = nullptr;
+            size_ = 0;
+            storage_ = Storage::owned;
+            memory_tag_ = 0;
+            allocator_ = nullptr;
+        }
+    public:
+        using value_type = T; /**< \brief Type of the stored values. */
+        using iterator = T*; /**< \brief Iterator type. */
+        using const_iterator = const T*; /**< \brief Const iterator type. */
+
+        ArrayBuffer() = default; /**< \brief Constructs an empty buffer. */
+        /** \brief Constructs a buffer of some size with all values initialized to zero. */
+        explicit ArrayBuffer(const size_t size) :size_(size)
+        {
+            if (size == 0) return;
+            if constexpr (std::is_trivial_v<T>)
+            {
+                if (ArrayArena* arena = ArrayArena::current())
+                {
+                    data_ = static_cast<T*>(arena->allocate(size * sizeof(T)));
+                    storage_ = Storage::arena;
+                }
+                else
+                {
+                    allocator_ = &ArrayAllocator::current();
+                    data_ = static_cast<T*>(allocator_->allocate(size * sizeof(T)));
+                    memory_tag_ = MemoryTracker::allocated(size * sizeof(T));
+                }
+                std::fill(data_, data_ + size, T());
+            }
+            else
+            {
+                data_ = new T[size]();
+                memory_tag_ = MemoryTracker::allocated(size * sizeof(T));
+            }
+        }
+        /** \brief Constructs a buffer of some size with all values set to \a value. */
+        ArrayBuffer(const size_t size, const T value) :ArrayBuffer(size) { std::fill(begin(), end(), value); }
+        /** \brief Constructs a buffer containing values of an \c std::initializer_list. */
+        ArrayBuffer(std::initializer_list<T> list) :ArrayBuffer(list.size())
+        {
+            std::copy(list.begin(), list.end(), begin());
+        }
+        /** \brief Constructs a buffer containing values of an iterator range, converting them to \c T. */
+        template <typename Iter, typename = std::enable_if_t<!std::is_arithmetic_v<Iter>>>
+        ArrayBuffer(Iter first, Iter last) :ArrayBuffer(size_t(std::distance(first, last)))
+        {
+            std::transform(first, last, begin(), [](const auto& value) { return T(value); });
+        }
+        /** \brief Copy constructor, always results in an owning buffer. */
+        ArrayBuffer(const ArrayBuffer& other) :ArrayBuffer(other.size_)
+        {
+            std::copy(other.begin(), other.end(), begin());
+        }
+        /** \brief Move constructor. */
+        ArrayBuffer(ArrayBuffer&& other) noexcept :
+            data_(std::exchange(other.data_, nullptr)),
+            size_(std::exchange(other.size_, 0)),
+            storage_(std::exchange(other.storage_, Storage::owned)),
+            memory_tag_(std::exchange(other.memory_tag_, 0)),
+            allocator_(std::exchange(other.allocator_, nullptr)) {}
+        ~ArrayBuffer() noexcept { release(); } /**< \brief Destructor. */
+        /** \brief Copy the contents of another buffer, always results in an owning buffer. */
+        ArrayBuffer& operator=(const ArrayBuffer& other)
+        {
+            if (this != &other)
+            {
+                ArrayBuffer copy(other);
+                *this = std::move(copy);
+            }
+            return *this;
+        }
+        /** \brief Move the contents of another buffer into this one. */
+        ArrayBuffer& operator=(ArrayBuffer&& other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                data_ = std::exchange(other.data_, nullptr);
+                size_ = std::exchange(other.size_, 0);
+                storage_ = std::exchange(other.storage_, Storage::owned);
+                memory_tag_ = std::exchange(other.memory_tag_, 0);
+                allocator_ = std::exchange(other.allocator_, nullptr);
+            }
+            return *this;
+        }
+
+        /**
+         * \brief Constructs a buffer viewing memory owned by others.
+         * \param data Pointer to the viewed memory.
+         * \param size Amount of values in the viewed memory.
+         * \remark The viewed memory should outlive the buffer and every view moved from it.
+         */
+        static ArrayBuffer view(T* data, const size_t size)
+        {
+            ArrayBuffer result;
+            result.data_ = data;
+            result.size_ = size;
+            result.storage_ = Storage::view;
+            return result;
+        }
+
+        /** \brief Check whether this buffer views memory owned by others. */
+        bool is_view() const { return storage_ == Storage::view; }
+        /** \brief Get the amount of values in the buffer. */
+        size_t size() const { return size_; }
+        /** \brief Check whether the buffer is empty. */
+        bool empty() const { return size_ == 0; }
+        /** \brief Get a pointer to the first value. */
+        T* data() { return data_; }
+        /** \brief Get a const pointer to the first value. */
+        const T* data() const { return data_; }
+        T* begin() { return data_; } /**< \brief Iterator to the first value. */
+        T* end() { return data_ + size_; } /**< \brief Iterator past the last value. */
+        const T* begin() const { return data_; } /**< \brief Const iterator to the first value. */
+        const T* end() const { return data_ + size_; } /**< \brief Const iterator past the last value. */
+        /** \brief Get a reference to a value, without checking the index. */
+        T& operator[](const size_t index) { return data_[index]; }
+        /** \brief Get a const reference to a value, without checking the index. */
+        const T& operator[](const size_t index) const { return data_[index]; }
+
+        /** \brief Copy values from an iterator range of the same size into the existing memory. */
+        template <typename Iter>
+        void assign(Iter first, Iter last)
+        {
+            if (size_t(std::distance(first, last)) != size_)
+                throw MismatchedSizesException("Size of the assigned values doesn't match that of the buffer");
+            std::copy(first, last, begin());
+        }
+        /**
+         * \brief Resize the buffer, keeping the leading values and filling new ones with zeros.
+         * \remark Views cannot be resized.
+         */
+        void resize(const size_t size)
+        {
+            if (size == size_) return;
+            if (storage_ == Storage::view) throw IllegalOperationException("Cannot resize a view of memory owned by others");
+            ArrayBuffer result(size);
+            std::copy(begin(), begin() + std::min(size, size_), result.begin());
+            *this = std::move(result);
+        }
+    };
+}
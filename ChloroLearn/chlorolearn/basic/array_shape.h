@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+
+#include "exceptions.h"
+
+namespace chloro
+{
+    /**
+     * \brief Shape of an \c Array, the lengths of its dimensions.
+     * \details The lengths are stored inline up to \c max_dimension dimensions, so that creating and copying
+     * shapes never allocates. The amount of elements and the row-major strides are cached, and kept up to
+     * date by every modification, which is why the lengths can only be changed through \c set and the other
+     * modifiers, not through iterators or references.
+     * \details Apart from that, a shape works like the \c std::vector<size_t> it replaces, \c size being the
+     * amount of dimensions.
+     */
+    class ArrayShape final
+    {
+    public:
+        using value_type = size_t; /**< \brief Type of the lengths. */
+        using iterator = const size_t*; /**< \brief Iterator type, the lengths can't be modified through it. */
+        using const_iterator = const size_t*; /**< \brief Const iterator type. */
+        /** \brief Maximum amount of dimensions. */
+        static constexpr size_t max_dimension = 8;
+    private:
+        std::array<size_t, max_dimension> lengths_{};
+        std::array<size_t, max_dimension> strides_{};
+        size_t element_count_ = 1;
+        size_t dimension_ = 0;
+        static void check_dimension(const size_t dimension)
+        {
+            if (dimension > max_dimension) throw ArgumentOutOfRangeException("Arrays can have at most 8 dimensions");
+        }
+        void update()
+        {
+            element_count_ = 1;
+            for (size_t i = dimension_; i > 0; i--)
+            {
+                strides_[i - 1] = element_count_;
+                element_count_ *= lengths_[i - 1];
+            }
+        }
+    public:
+        ArrayShape() = default; /**< \brief Constructs a shape of no dimensions. */
+        /** \brief Constructs a shape from the lengths of the dimensions, like <tt>ArrayShape{ 3, 4 }</tt>. */
+        ArrayShape(const std::initializer_list<size_t> lengths) :ArrayShape(lengths.begin(), lengths.end()) {}
+        /** \brief Constructs a shape of \a dimension dimensions with the same length. */
+        explicit ArrayShape(const size_t dimension, const size_t length = 0) :dimension_(dimension)
+        {
+            check_dimension(dimension);
+            for (size_t i = 0; i < dimension; i++) lengths_[i] = length;
+            update();
+        }
+        /** \brief Constructs a shape from an iterator range of lengths, converting them to \c size_t. */
+        template <typename Iter, typename = std::enable_if_t<!std::is_integral_v<Iter>>>
+        ArrayShape(Iter first, Iter last)
+        {
+            const size_t dimension = size_t(std::distance(first, last));
+            check_dimension(dimension);
+            for (; first != last; ++first) lengths_[dimension_++] = size_t(*first);
+            update();
+        }
+
+        /** \brief Get the amount of dimensions. */
+        size_t size() const { return dimension_; }
+        /** \brief Check whether the shape has no dimensions. */
+        bool empty() const { return dimension_ == 0; }
+        /** \brief Get the length of a dimension, without checking the index. */
+        size_t operator[](const size_t index) const { return lengths_[index]; }
+        /** \brief Get the length of the first dimension. */
+        size_t front() const { return lengths_[0]; }
+        /** \brief Get the length of the last dimension. */
+        size_t back() const { return lengths_[dimension_ - 1]; }
+        /** \brief Get a pointer to the lengths. */
+        const size_t* data() const { return lengths_.data(); }
+        const size_t* begin() const { return lengths_.data(); } /**< \brief Iterator to the first length. */
+        const size_t* end() const { return lengths_.data() + dimension_; } /**< \brief Iterator past the last length. */
+        /** \brief Get the amount of elements of an array of this shape, the product of the lengths. */
+        size_t element_count() const { return element_count_; }
+        /** \brief Get the distance between consecutive indices of a dimension in a row-major array. */
+        size_t stride(const size_t index) const { return strides_[index]; }
+
+        /** \brief Set the length of a dimension, without checking the index. */
+        void set(const size_t index, const size_t length)
+        {
+            lengths_[index] = length;
+            update();
+        }
+        /** \brief Append a dimension. */
+        void push_back(const size_t length)
+        {
+            check_dimension(dimension_ + 1);
+            lengths_[dimension_++] = length;
+            update();
+        }
+        /** \brief Remove the last dimension. */
+        void pop_back()
+        {
+            lengths_[--dimension_] = 0;
+            update();
+        }
+        /** \brief Insert a dimension before \a position. */
+        void insert(const const_iterator position, const size_t length)
+        {
+            check_dimension(dimension_ + 1);
+            const size_t index = size_t(position - begin());
+            for (size_t i = dimension_; i > index; i--) lengths_[i] = lengths_[i - 1];
+            lengths_[index] = length;
+            dimension_++;
+            update();
+        }
+        /** \brief Remove the dimension at \a position. */
+        void erase(const const_iterator position)
+        {
+            const size_t index = size_t(position - begin());
+            for (size_t i = index; i + 1 < dimension_; i++) lengths_[i] = lengths_[i + 1];
+            lengths_[--dimension_] = 0;
+            update();
+        }
+        /** \brief Change the amount of dimensions, new dimensions get the length \a length. */
+        void resize(const size_t dimension, const size_t length = 0)
+        {
+            check_dimension(dimension);
+            for (size_t i = dimension_; i < dimension; i++) lengths_[i] = length;
+            for (size_t i = dimension; i < dimension_; i++) lengths_[i] = 0;
+            dimension_ = dimension;
+            update();
+        }
+        /** \brief Remove all the dimensions. */
+        void clear() { resize(0); }
+
+        /** \brief Check whether two shapes have the same lengths. */
+        friend bool operator==(const ArrayShape& left, const ArrayShape& right)
+        {
+            // Lengths past the dimension are always zero
+            return left.dimension_ == right.dimension_ && left.lengths_ == right.lengths_;
+        }
+        /** \brief Check whether two shapes differ. */
+        friend bool operator!=(const ArrayShape& left, const ArrayShape& right) { return !(left == right); }
+    };
+
+    namespace detail
+    {
+        // Lengths of the dimensions before an axis, of the axis itself and of the dimensions after it
+        struct AxisSplit { size_t outer, length, inner; };
+
+        inline AxisSplit split_at_axis(const ArrayShape& shape, const size_t axis)
+        {
+            if (axis >= shape.size()) throw ArgumentOutOfRangeException("Axis out of range");
+            AxisSplit split{ 1, shape[axis], 1 };
+            for (size_t i = 0; i < axis; i++) split.outer *= shape[i];
+            for (size_t i = axis + 1; i < shape.size(); i++) split.inner *= shape[i];
+            return split;
+        }
+
+        // Shape with the axis removed, or { 1 } if no dimension is left
+        inline ArrayShape reduced_shape(const ArrayShape& shape, const size_t axis)
+        {
+            ArrayShape result = shape;
+            result.erase(result.begin() + axis);
+            if (result.empty()) result.push_back(1);
+            return result;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "array_allocator.h"
+#include "exceptions.h"
+
+namespace chloro
+{
+    /**
+     * \brief A non-owning view of contiguous values, for handing the memory of arrays to external kernels
+     * without copying.
+     * \tparam T Type of the values, \c const for read only access.
+     * \remark The viewed memory should outlive the span.
+     */
+    template <typename T>
+    class ArraySpan final
+    {
+    private:
+        T* data_ = nullptr;
+        size_t size_ = 0;
+    public:
+        using value_type = std::remove_cv_t<T>; /**< \brief Type of the values. */
+        using iterator = T*; /**< \brief Iterator type. */
+
+        ArraySpan() = default; /**< \brief Constructs an empty span. */
+        /** \brief Constructs a span of \a size values starting at \a data. */
+        ArraySpan(T* data, const size_t size) :data_(data), size_(size) {}
+        /** \brief Converts a span of mutable values to a span of const values. */
+        template <typename U, typename = std::enable_if_t<std::is_same_v<const U, T>>>
+        ArraySpan(const ArraySpan<U>& other) :data_(other.data()), size_(other.size()) {}
+
+        /** \brief Get the amount of values. */
+        size_t size() const { return size_; }
+        /** \brief Get the size of the values in bytes. */
+        size_t size_bytes() const { return size_ * sizeof(T); }
+        /** \brief Check whether the span is empty. */
+        bool empty() const { return size_ == 0; }
+        /** \brief Get a pointer to the first value. */
+        T* data() const { return data_; }
+        T* begin() const { return data_; } /**< \brief Iterator to the first value. */
+        T* end() const { return data_ + size_; } /**< \brief Iterator past the last value. */
+        /** \brief Get a reference to a value, without checking the index. */
+        T& operator[](const size_t index) const { return data_[index]; }
+        /** \brief Get a span of \a count values starting at \a offset. */
+        ArraySpan subspan(const size_t offset, const size_t count) const
+        {
+            if (offset > size_ || count > size_ - offset) throw ArgumentOutOfRangeException("Subspan out of range");
+            return { data_ + offset, count };
+        }
+        /** \brief Check whether the first value is aligned to \a alignment bytes. */
+        bool is_aligned(const size_t alignment = ArrayAllocator::alignment) const
+        {
+            return reinterpret_cast<uintptr_t>(data_) % alignment == 0;
+        }
+    };
+}
@@ -7,9 +7,13 @@ namespace chloro
     /** \brief Base class for all the exceptions in this library. */
     class ChloroException : public std::exception
     {
+    private:
+        const char* message_ = "Unknown exception";
     public:
         ChloroException() = default; /**< \brief Default constructor. */
-        explicit ChloroException(const char* message) : std::exception(message) {} /**< Construct using a message string. */
+        explicit ChloroException(const char* message) : message_(message) {} /**< Construct using a message string. */
+        /** \brief Get the message, which should be a string literal or otherwise outlive the exception. */
+        const char* what() const noexcept override { return message_; }
     };
 
 #define CHLORO_EXCEPTION(name) class name : public ChloroException \
@@ -25,6 +29,7 @@ namespace chloro
     CHLORO_EXCEPTION(IllegalArgumentException);
     CHLORO_EXCEPTION(IllegalOperationException);
     CHLORO_EXCEPTION(NotImplementedException);
+    CHLORO_EXCEPTION(IOException);
 
 #undef CHLORO_EXCEPTION
 }
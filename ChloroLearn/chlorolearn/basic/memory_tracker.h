@@ -0,0 +1,287 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+
+#include "exceptions.h"
+
+namespace chloro
+{
+    /** \brief Categories of the memory used by arrays. */
+    enum class MemoryCategory : uint8_t
+    {
+        other, /**< \brief Allocations outside of any scope, like arrays of the users. */
+        parameters, /**< \brief Values and gradients of the variables. */
+        inputs, /**< \brief Values fed into the input nodes. */
+        activations, /**< \brief Values of the operators, and temporaries of evaluating them. */
+        gradients, /**< \brief Gradients of the operators, and temporaries of back propagating them. */
+        state, /**< \brief Internal states of the operators. */
+        optimizer /**< \brief States and temporaries of the optimizers. */
+    };
+
+    /** \brief Amount of the memory categories. */
+    constexpr size_t memory_category_count = 7;
+
+    /** \brief Tracked memory usage of a category, an owner, or all the arrays. */
+    struct MemoryUsage final
+    {
+        size_t current = 0; /**< \brief Bytes allocated and not released yet. */
+        size_t peak = 0; /**< \brief Maximum of the current bytes since the peaks were last reset. */
+        size_t allocations = 0; /**< \brief Amount of allocations. */
+    };
+
+    namespace detail
+    {
+        struct MemoryCounter
+        {
+            std::atomic<size_t> current{ 0 };
+            std::atomic<size_t> peak{ 0 };
+            std::atomic<size_t> allocations{ 0 };
+            static void raise(std::atomic<size_t>& peak, const size_t value)
+            {
+                size_t previous = peak.load(std::memory_order_relaxed);
+                while (previous < value && !peak.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {}
+            }
+            size_t add(const size_t bytes)
+            {
+                const size_t now = current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+                allocations.fetch_add(1, std::memory_order_relaxed);
+                raise(peak, now);
+                return now;
+            }
+            void subtract(const size_t bytes) { current.fetch_sub(bytes, std::memory_order_relaxed); }
+            MemoryUsage load() const
+            {
+                return { current.load(std::memory_order_relaxed), peak.load(std::memory_order_relaxed),
+                    allocations.load(std::memory_order_relaxed) };
+            }
+            void reset_peak() { peak.store(current.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+        };
+
+        struct MemoryScopeState
+        {
+            MemoryCategory category = MemoryCategory::other;
+            uint32_t owner = 0;
+        };
+    }
+
+    /**
+     * \brief Tracks the memory allocated for the values of arrays.
+     * \details When enabled, every allocation of array storage is counted into the total usage, the usage of
+     * the category and the usage of the owner of the innermost \c MemoryScope on the allocating thread. The
+     * allocation remembers where it was counted, so releasing it on any thread is attributed correctly.
+     * Allocations made while tracking is disabled are never counted. When disabled, the cost of tracking is
+     * a relaxed atomic load per allocation.
+     * \details Besides the peaks, a watermark records the peak of the total usage since it was last reset,
+     * for measuring the peak of a single pass without disturbing the other peaks.
+     */
+    class MemoryTracker final
+    {
+        friend class MemoryScope;
+    private:
+        using Counter = detail::MemoryCounter;
+        using Scope = detail::MemoryScopeState;
+        // Owners are stored in chunks which are never moved, so that counting needs no locking
+        static constexpr size_t chunk_size = 1024;
+        static constexpr size_t max_owners = size_t(1) << 24;
+        static constexpr uint32_t owner_mask = uint32_t(max_owners - 1);
+        inline static std::atomic<bool> enabled_{ false };
+        inline static Counter total_;
+        inline static std::atomic<size_t> watermark_{ 0 };
+        inline static std::array<Counter, memory_category_count> categories_;
+        inline static std::array<std::atomic<Counter*>, max_owners / chunk_size> owner_chunks_{};
+        inline static std::vector<std::string> owner_names_{ "unattributed" };
+        inline static std::vector<uint32_t> removed_owners_;
+        inline static std::mutex mutex_;
+        static Scope& scope()
+        {
+            thread_local Scope scope;
+            return scope;
+        }
+        static Counter* owner_counter(const uint32_t owner)
+        {
+            Counter* chunk = owner_chunks_[owner / chunk_size].load(std::memory_order_acquire);
+            return chunk ? chunk + owner % chunk_size : nullptr;
+        }
+    public:
+        MemoryTracker() = delete;
+        /** \brief Enable or disable tracking. */
+        static void enable(const bool enabled = true) { enabled_.store(enabled, std::memory_order_relaxed); }
+        /** \brief Check whether tracking is enabled. */
+        static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+        /**
+         * \brief Add an owner which allocations can be attributed to, like a node of a graph.
+         * \details Ids of removed owners are reused once all the memory attributed to them is released.
+         * \param name Name of the owner shown in the report.
+         * \return Id of the owner, to be used in a \c MemoryScope. Id 0 is reserved for unattributed memory.
+         */
+        static uint32_t add_owner(std::string name)
+        {
+            std::lock_guard lock(mutex_);
+            for (size_t i = 0; i < removed_owners_.size(); i++)
+            {
+                const uint32_t owner = removed_owners_[i];
+                Counter* counter = owner_counter(owner);
+                if (counter->current.load(std::memory_order_relaxed) != 0) continue;
+                removed_owners_[i] = removed_owners_.back();
+                removed_owners_.pop_back();
+                counter->peak.store(0, std::memory_order_relaxed);
+                counter->allocations.store(0, std::memory_order_relaxed);
+                owner_names_[owner] = std::move(name);
+                return owner;
+            }
+            const size_t owner = owner_names_.size();
+            if (owner >= max_owners) throw IllegalOperationException("Too many memory owners");
+            std::atomic<Counter*>& chunk = owner_chunks_[owner / chunk_size];
+            if (!chunk.load(std::memory_order_relaxed)) chunk.store(new Counter[chunk_size], std::memory_order_release);
+            owner_names_.push_back(std::move(name));
+            return uint32_t(owner);
+        }
+        /**
+         * \brief Remove an owner which no more allocations are attributed to, so that its id can be reused.
+         * \details Memory still attributed to the owner keeps being counted until it's released.
+         */
+        static void remove_owner(const uint32_t owner)
+        {
+            std::lock_guard lock(mutex_);
+            if (owner == 0 || owner >= owner_names_.size())
+                throw ArgumentOutOfRangeException("Memory owner out of range");
+            removed_owners_.push_back(owner);
+        }
+        /** \brief Change the name of an owner shown in the report. */
+        static void rename_owner(const uint32_t owner, std::string name)
+        {
+            std::lock_guard lock(mutex_);
+            if (owner >= owner_names_.size()) throw ArgumentOutOfRangeException("Memory owner out of range");
+            owner_names_[owner] = std::move(name);
+        }
+        /** \brief Get the amount of owners, including the reserved owner 0 and the removed ones. */
+        static size_t owner_count()
+        {
+            std::lock_guard lock(mutex_);
+            return owner_names_.size();
+        }
+        /** \brief Get the name of an owner. */
+        static std::string owner_name(const uint32_t owner)
+        {
+            std::lock_guard lock(mutex_);
+            if (owner >= owner_names_.size()) throw ArgumentOutOfRangeException("Memory owner out of range");
+            return owner_names_[owner];
+        }
+        /** \brief Get the usage of all the tracked arrays. */
+        static MemoryUsage usage() { return total_.load(); }
+        /** \brief Get the usage of a category. */
+        static MemoryUsage usage(const MemoryCategory category) { return categories_[size_t(category)].load(); }
+        /** \brief Get the usage of an owner. */
+        static MemoryUsage owner_usage(const uint32_t owner)
+        {
+            if (owner >= owner_count()) throw ArgumentOutOfRangeException("Memory owner out of range");
+            const Counter* counter = owner_counter(owner);
+            return counter ? counter->load() : MemoryUsage{};
+        }
+        /** \brief Reset the peaks of the total usage, the categories and the owners to the current usages. */
+        static void reset_peaks()
+        {
+            total_.reset_peak();
+            for (Counter& counter : categories_) counter.reset_peak();
+            const size_t owners = owner_count();
+            for (size_t i = 0; i < owners; i++)
+                if (Counter* counter = owner_counter(uint32_t(i))) counter->reset_peak();
+        }
+        /** \brief Get the peak of the total usage since the watermark was last reset. */
+        static size_t watermark() { return watermark_.load(std::memory_order_relaxed); }
+        /** \brief Reset the watermark to the current total usage. */
+        static void reset_watermark() { watermark_.store(total_.current.load(std::memory_order_relaxed)); }
+        /**
+         * \brief Write a report of the usages of the categories and the owners.
+         * \param stream The stream to write into.
+         * \param max_owners Maximum amount of owners listed, the ones with the highest peaks are listed.
+         */
+        static void write_report(std::ostream& stream, const size_t max_owners = 20)
+        {
+            static const char* const names[memory_category_count] =
+                { "other", "parameters", "inputs", "activations", "gradients", "state", "optimizer" };
+            char line[160];
+            const auto write_row = [&](const std::string& name, const MemoryUsage& usage)
+            {
+                std::snprintf(line, sizeof(line), "%-32.32s %14.3f %14.3f %12zu\n", name.c_str(),
+                    double(usage.current) / 1048576, double(usage.peak) / 1048576, usage.allocations);
+                stream << line;
+            };
+            std::snprintf(line, sizeof(line), "%-32s %14s %14s %12s\n", "category", "current MiB", "peak MiB",
+                "allocations");
+            stream << line;
+            for (size_t i = 0; i < memory_category_count; i++)
+                write_row(names[i], categories_[i].load());
+            write_row("total", total_.load());
+            std::vector<std::pair<uint32_t, MemoryUsage>> owners;
+            const size_t owner_amount = owner_count();
+            for (size_t i = 1; i < owner_amount; i++)
+            {
+                const MemoryUsage usage = owner_usage(uint32_t(i));
+                if (usage.allocations > 0) owners.emplace_back(uint32_t(i), usage);
+            }
+            if (owners.empty()) return;
+            std::stable_sort(owners.begin(), owners.end(),
+                [](const auto& left, const auto& right) { return left.second.peak > right.second.peak; });
+            if (owners.size() > max_owners) owners.resize(max_owners);
+            std::snprintf(line, sizeof(line), "%-32s %14s %14s %12s\n", "owner", "current MiB", "peak MiB",
+                "allocations");
+            stream << line;
+            for (const auto& [owner, usage] : owners) write_row(owner_name(owner), usage);
+        }
+
+        /**
+         * \brief Count an allocation, called by the array storage.
+         * \param bytes Size of the allocation.
+         * \return A tag to be passed to \c released, 0 for allocations which are not counted.
+         */
+        static uint32_t allocated(const size_t bytes)
+        {
+            if (!enabled_.load(std::memory_order_relaxed)) return 0;
+            const Scope& current = scope();
+            Counter::raise(watermark_, total_.add(bytes));
+            categories_[size_t(current.category)].add(bytes);
+            if (current.owner != 0) owner_counter(current.owner)->add(bytes);
+            return uint32_t(size_t(current.category) + 1) << 24 | current.owner;
+        }
+        /** \brief Count a release of an allocation, called by the array storage. */
+        static void released(const uint32_t tag, const size_t bytes)
+        {
+            if (tag == 0) return;
+            total_.subtract(bytes);
+            categories_[(tag >> 24) - 1].subtract(bytes);
+            if (const uint32_t owner = tag & owner_mask) owner_counter(owner)->subtract(bytes);
+        }
+    };
+
+    /**
+     * \brief Attributes the allocations on the current thread to a category and an owner, until the scope
+     * is destroyed. Scopes can be nested, the innermost one takes effect.
+     */
+    class MemoryScope final
+    {
+    private:
+        MemoryTracker::Scope previous_;
+    public:
+        /**
+         * \brief Enter a scope.
+         * \param category Category of the allocations in the scope.
+         * \param owner Id of the owner of the allocations, 0 for unattributed.
+         */
+        explicit MemoryScope(const MemoryCategory category, const uint32_t owner = 0) :previous_(MemoryTracker::scope())
+        {
+            MemoryTracker::scope() = { category, owner };
+        }
+        MemoryScope(const MemoryScope&) = delete;
+        MemoryScope& operator=(const MemoryScope&) = delete;
+        ~MemoryScope() noexcept { MemoryTracker::scope() = previous_; } /**< \brief Leave the scope. */
+    };
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace chloro
+{
+    /**
+     * \brief Minimal amount of scalar operations a worker thread should get in parallel kernels.
+     * \details Ranges smaller than this are processed on the calling thread, since handing them to the
+     * worker threads would cost more than the computation itself.
+     */
+    inline constexpr size_t parallel_grain = size_t(1) << 16;
+
+    namespace detail
+    {
+        inline size_t& thread_count_storage()
+        {
+            static size_t count = std::max(size_t(std::thread::hardware_concurrency()), size_t(1));
+            return count;
+        }
+
+        // Worker threads kept alive between the parallel kernels, which process the chunks of one kernel
+        // at a time together with the thread calling it. The workers are started when first needed.
+        class ThreadPool final
+        {
+        private:
+            using Task = void (*)(void* context, size_t chunk);
+            std::vector<std::thread> workers_;
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            std::condition_variable done_;
+            std::mutex busy_; // Held by the thread running a kernel on the pool
+            Task task_ = nullptr;
+            void* context_ = nullptr;
+            size_t chunk_count_ = 0;
+            std::atomic<size_t> next_chunk_{ 0 };
+            size_t working_ = 0;
+            size_t generation_ = 0;
+            bool stopping_ = false;
+            ThreadPool() = default;
+            static bool& is_worker()
+            {
+                thread_local bool worker = false;
+                return worker;
+            }
+            void run_chunks()
+            {
+                for (size_t chunk; (chunk = next_chunk_.fetch_add(1, std::memory_order_relaxed)) < chunk_count_;)
+                    task_(context_, chunk);
+            }
+            void work(size_t generation)
+            {
+                is_worker() = true;
+                std::unique_lock<std::mutex> lock(mutex_);
+                while (true)
+                {
+                    wake_.wait(lock, [&] { return stopping_ || generation_ != generation; });
+                    if (stopping_) return;
+                    generation = generation_;
+                    lock.unlock();
+                    run_chunks();
+                    lock.lock();
+                    if (--working_ == 0) done_.notify_one();
+                }
+            }
+        public:
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+            ~ThreadPool() noexcept
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stopping_ = true;
+                }
+                wake_.notify_all();
+                for (std::thread& worker : workers_) worker.join();
+            }
+            static ThreadPool& instance()
+            {
+                static ThreadPool pool;
+                return pool;
+            }
+            // Calls task(context, chunk) for every chunk in [0, chunk_count) on the workers and the calling
+            // thread. Returns false without calling anything if the pool is in use, by another thread or by
+            // the kernel this call is nested in, in which case the caller should process the chunks itself.
+            bool run(const size_t chunk_count, const Task task, void* context)
+            {
+                if (is_worker()) return false;
+                std::unique_lock<std::mutex> busy(busy_, std::try_to_lock);
+                if (!busy.owns_lock()) return false;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    while (workers_.size() + 1 < chunk_count)
+                        workers_.emplace_back([this, generation = generation_] { work(generation); });
+                    task_ = task;
+                    context_ = context;
+                    chunk_count_ = chunk_count;
+                    next_chunk_.store(0, std::memory_order_relaxed);
+                    working_ = workers_.size();
+                    generation_++;
+                }
+                wake_.notify_all();
+                run_chunks();
+                std::unique_lock<std::mutex> lock(mutex_);
+                done_.wait(lock, [&] { return working_ == 0; });
+                return true;
+            }
+        };
+    }
+
+    /** \brief Get the maximum amount of threads used by the parallel kernels in this library. */
+    inline size_t thread_count() { return detail::thread_count_storage(); }
+
+    /**
+     * \brief Set the maximum amount of threads used by the parallel kernels in this library.
+     * \param count The thread amount, 0 for the hardware concurrency.
+     */
+    inline void set_thread_count(const size_t count)
+    {
+        detail::thread_count_storage() = count == 0 ?
+            std::max(size_t(std::thread::hardware_concurrency()), size_t(1)) : count;
+    }
+
+    /**
+     * \brief Split the range [0, \a count) into contiguous chunks and process them in parallel.
+     * \param count Length of the range.
+     * \param cost Estimated amount of scalar operations needed for processing one index of the range,
+     * used for deciding how many threads are worth using.
+     * \param function A function taking the beginning and the end of a chunk as parameters.
+     * \details The chunks are processed by the calling thread and a pool of worker threads, which is started
+     * on the first call and reused afterwards. Calls nested in a chunk, or made while another thread is
+     * running a parallel kernel, process the whole range on the calling thread.
+     * \remark The function should not throw, and the chunks should not write to overlapping memory.
+     */
+    template <typename Func>
+    void parallel_for(const size_t count, const size_t cost, Func&& function)
+    {
+        const size_t total = count * std::max(cost, size_t(1));
+        const size_t chunks = std::min({ thread_count(), count, total / parallel_grain });
+        if (chunks <= 1)
+        {
+            if (count != 0) function(size_t(0), count);
+            return;
+        }
+        const size_t chunk_size = (count + chunks - 1) / chunks;
+        auto run_chunk = [&function, count, chunk_size](const size_t chunk)
+        {
+            const size_t begin = chunk * chunk_size;
+            if (begin < count) function(begin, std::min(begin + chunk_size, count));
+        };
+        using Chunk = decltype(run_chunk);
+        const auto task = [](void* context, const size_t chunk) { (*static_cast<Chunk*>(context))(chunk); };
+        if (!detail::ThreadPool::instance().run(chunks, task, &run_chunk))
+            function(size_t(0), count);
+    }
+}
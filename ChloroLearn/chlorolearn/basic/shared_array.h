@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+
+#include "array.h"
+
+namespace chloro
+{
+    /**
+     * \brief An immutable array shared by reference counting, for large values read in many places, like
+     * constants of several graphs, or lookup tables which should be loaded once per process.
+     * \details Copying a shared array only adds a reference, and the values are freed with the last
+     * reference. The values can't be written through any of the references, writing needs a copy of its own
+     * made by \c copy, so a shared array is effectively copy-on-write. Reading it from several threads is safe.
+     * \remark Sharing is explicit rather than a mode of \c Array, so that writing elements of arrays never
+     * has to check whether the values are shared.
+     * \tparam T Type of data stored in the array.
+     */
+    template <typename T>
+    class SharedArray final
+    {
+    private:
+        std::shared_ptr<const Array<T>> array_;
+    public:
+        /** \brief Constructs a shared empty array. */
+        SharedArray() :array_(std::make_shared<const Array<T>>()) {}
+        /**
+         * \brief Constructs a shared array from an array, moving the values in when possible.
+         * \details Views are copied, so that the shared array never depends on memory owned by others.
+         */
+        explicit SharedArray(Array<T> array) :
+            array_(std::make_shared<const Array<T>>(array.is_view() ? Array<T>(array) : std::move(array))) {}
+
+        /** \brief Get the shared array. */
+        const Array<T>& get() const { return *array_; }
+        /** \brief Get the shared array. */
+        const Array<T>& operator*() const { return *array_; }
+        /** \brief Access members of the shared array. */
+        const Array<T>* operator->() const { return array_.get(); }
+        /** \brief Use the shared array wherever a read only array is expected. */
+        operator const Array<T>&() const { return *array_; }
+        /** \brief Get a copy of the values which can be written. */
+        Array<T> copy() const { return *array_; }
+        /** \brief Get the amount of references to the values, including this one. */
+        long use_count() const { return array_.use_count(); }
+    };
+}
@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#include "code_generator.h"
+#include "graph.h"
+
+namespace chloro
+{
+    namespace
+    {
+        struct OperatorSource
+        {
+            const OperatorDescriptor& descriptor;
+            std::vector<std::string> operands;
+            std::vector<ArrayShape> operand_shapes;
+            ArrayShape shape;
+            std::string result;
+        };
+
+        std::string literal(const double value)
+        {
+            if (std::isnan(value)) return "std::numeric_limits<double>::quiet_NaN()";
+            if (std::isinf(value))
+                return value > 0 ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()";
+            // Hexadecimal floating point literals keep the values exact
+            std::ostringstream stream;
+            stream << std::hexfloat << value;
+            return stream.str();
+        }
+
+        size_t size_attribute(const OperatorSource& source, const size_t index)
+        {
+            if (index >= source.descriptor.attributes.size())
+                throw IllegalArgumentException("Missing attributes of the operator");
+            return size_t(source.descriptor.attributes[index]);
+        }
+
+        double attribute(const OperatorSource& source, const size_t index)
+        {
+            if (index >= source.descriptor.attributes.size())
+                throw IllegalArgumentException("Missing attributes of the operator");
+            return source.descriptor.attributes[index];
+        }
+
+        void write_values(std::ostream& stream, const std::string& name, const Array<double>& value)
+        {
+            const size_t size = value.size();
+            stream << "    alignas(64) const double " << name << "[" << size << "] =\n    {";
+            for (size_t i = 0; i < size; i++)
+            {
+                if (i % 4 == 0) stream << "\n       ";
+                stream << " " << literal(value[i]) << ",";
+            }
+            stream << "\n    };\n";
+        }
+
+        void write_elementwise(std::ostream& body, const OperatorSource& source, const std::string& expression)
+        {
+            body << "    for (std::size_t i = 0; i < " << source.shape.element_count() << "; i++) "
+                << source.result << "[i] = " << expression << ";\n";
+        }
+
+        void write_reduction(std::ostream& body, const OperatorSource& source)
+        {
+            const std::string& kind = source.descriptor.kind;
+            const ArrayShape& shape = source.operand_shapes[0];
+            const size_t axis = size_attribute(source, 0);
+            size_t outer = 1, inner = 1;
+            for (size_t i = 0; i < axis; i++) outer *= shape[i];
+            for (size_t i = axis + 1; i < shape.size(); i++) inner *= shape[i];
+            const size_t length = shape[axis];
+            const std::string element = "in[j * " + std::to_string(inner) + "]";
+            body << "    for (std::size_t i = 0; i < " << outer << "; i++)\n"
+                << "        for (std::size_t k = 0; k < " << inner << "; k++)\n"
+                << "        {\n"
+                << "            const double* in = " << source.operands[0] << " + i * " << length * inner << " + k;\n"
+                << "            double value = in[0];\n";
+            if (kind == "argmax") body << "            std::size_t index = 0;\n";
+            body << "            for (std::size_t j = 1; j < " << length << "; j++)";
+            if (kind == "sum" || kind == "mean") body << " value += " << element << ";\n";
+            else if (kind == "max") body << " value = std::max(value, " << element << ");\n";
+            else body << "\n"
+                << "                if (" << element << " > value)\n"
+                << "                {\n"
+                << "                    value = " << element << ";\n"
+                << "                    index = j;\n"
+                << "                }\n";
+            body << "            " << source.result << "[i * " << inner << " + k] = ";
+            if (kind == "mean") body << "value / " << length << ";\n";
+            else if (kind == "argmax") body << "double(index);\n";
+            else body << "value;\n";
+            body << "        }\n";
+        }
+
+        void write_matrix_multiply(std::ostream& body, const OperatorSource& source)
+        {
+            const size_t left_row = source.operand_shapes[0][0];
+            const size_t left_col = source.operand_shapes[0][1];
+            const size_t right_col = source.operand_shapes[1][1];
+            const std::string& result = source.result;
+            // The i-k-j order keeps the innermost loop contiguous, while the sums are in the same order
+            body << "    std::fill(" << result << ", " << result << " + " << left_row * right_col << ", 0.0);\n"
+                << "    for (std::size_t i = 0; i < " << left_row << "; i++)\n"
+                << "        for (std::size_t k = 0; k < " << left_col << "; k++)\n"
+                << "        {\n"
+                << "            const double left = " << source.operands[0] << "[i * " << left_col << " + k];\n"
+                << "            for (std::size_t j = 0; j < " << right_col << "; j++)\n"
+                << "                " << result << "[i * " << right_col << " + j] += left * "
+                << source.operands[1] << "[k * " << right_col << " + j];\n"
+                << "        }\n";
+        }
+
+        void write_convolution(std::ostream& body, const OperatorSource& source)
+        {
+            const ArrayShape& input_shape = source.operand_shapes[0];
+            const ArrayShape& filter_shape = source.operand_shapes[1];
+            const size_t input_row = input_shape[0];
+            const size_t input_column = input_shape[1];
+            const size_t features = input_shape[2];
+            const size_t filter_row = filter_shape[1];
+            const size_t filter_column = filter_shape[2];
+            const size_t stride_row = size_attribute(source, 0);
+            const size_t stride_column = size_attribute(source, 1);
+            const size_t output_row = source.shape[0];
+            const size_t output_column = source.shape[1];
+            const size_t filter_amount = source.shape[2];
+            const std::string& result = source.result;
+            body << "    for (std::size_t i = 0; i < " << filter_amount << "; i++)\n"
+                << "        for (std::size_t j = 0; j < " << output_row << "; j++)\n"
+                << "            for (std::size_t k = 0; k < " << output_column << "; k++)\n"
+                << "            {\n"
+                << "                const std::size_t max_row = std::min<std::size_t>(" << filter_row << ", "
+                << input_row << " - j * " << stride_row << ");\n"
+                << "                const std::size_t max_column = std::min<std::size_t>(" << filter_column << ", "
+                << input_column << " - k * " << stride_column << ");\n"
+                << "                double sum = 0.0;\n"
+                << "                for (std::size_t l = 0; l < max_row; l++)\n"
+                << "                    for (std::size_t m = 0; m < max_column; m++)\n"
+                << "                        for (std::size_t n = 0; n < " << features << "; n++)\n"
+                << "                            sum += " << source.operands[0] << "[((j * " << stride_row
+                << " + l) * " << input_column << " + k * " << stride_column << " + m) * " << features << " + n] * "
+                << source.operands[1] << "[((i * " << filter_row << " + l) * " << filter_column << " + m) * "
+                << features << " + n];\n"
+                << "                " << result << "[(j * " << output_column << " + k) * " << filter_amount
+                << " + i] = sum;\n"
+                << "            }\n";
+        }
+
+        void write_max_pool(std::ostream& body, const OperatorSource& source)
+        {
+            const ArrayShape& input_shape = source.operand_shapes[0];
+            const size_t input_row = input_shape[0];
+            const size_t input_column = input_shape[1];
+            const size_t features = input_shape[2];
+            const size_t pool_row = size_attribute(source, 0);
+            const size_t pool_column = size_attribute(source, 1);
+            const size_t stride_row = size_attribute(source, 2);
+            const size_t stride_column = size_attribute(source, 3);
+            const size_t output_row = source.shape[0];
+            const size_t output_column = source.shape[1];
+            body << "    for (std::size_t i = 0; i < " << output_row << "; i++)\n"
+                << "        for (std::size_t j = 0; j < " << output_column << "; j++)\n"
+                << "        {\n"
+                << "            const std::size_t max_row = std::min<std::size_t>(" << pool_row << ", "
+                << input_row << " - i * " << stride_row << ");\n"
+                << "            const std::size_t max_column = std::min<std::size_t>(" << pool_column << ", "
+                << input_column << " - j * " << stride_column << ");\n"
+                << "            for (std::size_t k = 0; k < " << features << "; k++)\n"
+                << "            {\n"
+                << "                double max = std::numeric_limits<double>::lowest();\n"
+                << "                for (std::size_t l = 0; l < max_row; l++)\n"
+                << "                    for (std::size_t m = 0; m < max_column; m++)\n"
+                << "                        max = std::max(max, " << source.operands[0] << "[((i * " << stride_row
+                << " + l) * " << input_column << " + j * " << stride_column << " + m) * " << features << " + k]);\n"
+                << "                " << source.result << "[(i * " << output_column << " + j) * " << features
+                << " + k] = max;\n"
+                << "            }\n"
+                << "        }\n";
+        }
+
+        void write_operator(std::ostream& body, const OperatorSource& source)
+        {
+            const std::string& kind = source.descriptor.kind;
+            const std::vector<std::string>& operands = source.operands;
+            const std::string& result = source.result;
+            const size_t size = source.shape.element_count();
+            const std::string in = operands[0] + "[i]";
+            if (kind == "add" || kind == "subtract" || kind == "multiply" || kind == "divide")
+            {
+                const char* symbol = kind == "add" ? " + " : kind == "subtract" ? " - " : kind == "multiply" ? " * " : " / ";
+                write_elementwise(body, source, in + symbol + operands[1] + "[i]");
+            }
+            else if (kind == "relu") write_elementwise(body, source, in + " > 0 ? " + in + " : 0.0");
+            else if (kind == "leaky_relu") write_elementwise(body, source, in + " > 0 ? " + in + " : 0.01 * " + in);
+            else if (kind == "sigmoid") write_elementwise(body, source, "1 / (1 + std::exp(-" + in + "))");
+            else if (kind == "power") write_elementwise(body, source, "std::pow(" + in + ", " + literal(attribute(source, 0)) + ")");
+            else if (kind == "exp") write_elementwise(body, source, "std::pow(" + literal(attribute(source, 0)) + ", " + in + ")");
+            else if (kind == "dropout") write_elementwise(body, source, literal(1 - attribute(source, 0)) + " * " + in);
+            else if (kind == "repeat")
+                body << "    std::fill(" << result << ", " << result << " + " << size << ", " << operands[0] << "[0]);\n";
+            else if (kind == "softmax")
+            {
+                body << "    {\n"
+                    << "        double max = " << operands[0] << "[0];\n"
+                    << "        for (std::size_t i = 0; i < " << size << "; i++) max = std::max(max, " << in << ");\n"
+                    << "        double sum = 0.0;\n"
+                    << "        for (std::size_t i = 0; i < " << size << "; i++) sum += " << result
+                    << "[i] = std::exp(" << in << " - max);\n"
+                    << "        for (std::size_t i = 0; i < " << size << "; i++) " << result << "[i] /= sum;\n"
+                    << "    }\n";
+            }
+            else if (kind == "sum" && source.descriptor.attributes.empty())
+            {
+                body << "    {\n"
+                    << "        double sum = 0.0;\n"
+                    << "        for (std::size_t i = 0; i < " << source.operand_shapes[0].element_count()
+                    << "; i++) sum += " << in << ";\n"
+                    << "        " << result << "[0] = sum;\n"
+                    << "    }\n";
+            }
+            else if (kind == "sum" || kind == "mean" || kind == "max" || kind == "argmax") write_reduction(body, source);
+            else if (kind == "categorical_cross_entropy")
+                body << "    " << result << "[0] = -std::log(" << operands[0] << "[std::size_t(" << operands[1]
+                    << "[0])] + " << literal(1e-8) << ");\n";
+            else if (kind == "matrix_multiply") write_matrix_multiply(body, source);
+            else if (kind == "convolution_2d_with_padding") write_convolution(body, source);
+            else if (kind == "max_pool_2d") write_max_pool(body, source);
+            else throw NotImplementedException("Code generation of the operator kind is not supported");
+        }
+    }
+
+    CodeGenerator::CodeGenerator(Node& target, const std::vector<NodeRef>& inputs) :target_(&target)
+    {
+        for (const NodeRef input : inputs)
+        {
+            if (input.get().content_.index() != Node::InputType)
+                throw IllegalArgumentException("Inputs of generated code should be Input nodes");
+            inputs_.push_back(&input.get());
+        }
+        // Dependency order like ExecutionPlan, but also keeping the leaf nodes
+        Graph& graph = *target.graph_;
+        for (const size_t id : graph.topological_order(target))
+        {
+            Node* node = &graph.nodes_[id];
+            if (node->content_.index() == Node::InputType
+                && std::find(inputs_.begin(), inputs_.end(), node) == inputs_.end())
+                throw IllegalArgumentException("All the Input nodes which the target depends on should be given");
+            nodes_.push_back(node);
+        }
+    }
+
+    void CodeGenerator::generate(std::ostream& stream, const std::string& function_name) const
+    {
+        if (function_name.empty()) throw IllegalArgumentException("Function name should not be empty");
+        Graph& graph = *target_->graph_;
+        std::unordered_map<const Node*, std::string> names;
+        for (size_t i = 0; i < inputs_.size(); i++) names[inputs_[i]] = "input_" + std::to_string(i);
+        std::ostringstream data, body;
+        for (size_t i = 0; i < nodes_.size(); i++)
+        {
+            Node& node = *nodes_[i];
+            const std::string name = (node.content_.index() == Node::OperatorType ? "value_" : "weight_")
+                + std::to_string(i);
+            if (node.content_.index() == Node::InputType) continue;
+            if (node.content_.index() != Node::OperatorType)
+            {
+                write_values(data, name, node.value());
+                names[&node] = name;
+                continue;
+            }
+            const OperatorDescriptor& descriptor = std::get<Node::OperatorType>(node.content_).descriptor();
+            // Reshapes and identities only rename the values
+            if (descriptor.kind == "reshape" || descriptor.kind == "identity")
+            {
+                names[&node] = names.at(&graph.nodes_[graph.childs(node.id_)[0]]);
+                continue;
+            }
+            OperatorSource source{ descriptor, {}, {}, node.shape(), name };
+            for (const size_t id : graph.childs(node.id_))
+            {
+                Node& child = graph.nodes_[id];
+                source.operands.push_back(names.at(&child));
+                source.operand_shapes.push_back(child.shape());
+            }
+            body << "    // " << (descriptor.kind.empty() ? "custom operator" : descriptor.kind) << "\n";
+            write_operator(body, source);
+            data << "    alignas(64) double " << name << "[" << source.shape.element_count() << "];\n";
+            names[&node] = name;
+        }
+        const size_t output_size = target_->shape().element_count();
+        stream << "// Generated by ChloroLearn. Shapes of the inputs and the output:\n";
+        for (size_t i = 0; i < inputs_.size(); i++)
+        {
+            stream << "// input_" << i << ":";
+            for (const size_t length : inputs_[i]->shape()) stream << " " << length;
+            stream << "\n";
+        }
+        stream << "// output:";
+        for (const size_t length : target_->shape()) stream << " " << length;
+        stream << "\n\n"
+            << "#include <algorithm>\n"
+            << "#include <cmath>\n"
+            << "#include <cstddef>\n"
+            << "#include <limits>\n\n"
+            << "namespace\n{\n" << data.str() << "}\n\n"
+            << "void " << function_name << "(";
+        for (size_t i = 0; i < inputs_.size(); i++) stream << "const double* input_" << i << ", ";
+        const std::string& output = names.at(target_);
+        stream << "double* output)\n{\n" << body.str()
+            << "    std::copy(" << output << ", " << output << " + " << output_size << ", output);\n"
+            << "}\n";
+    }
+
+    void CodeGenerator::generate(const std::string& path, const std::string& function_name) const
+    {
+        std::ostringstream source;
+        generate(source, function_name);
+        std::ofstream stream(path);
+        if (!(stream << source.str())) throw IOException("Failed to write the source file");
+    }
+}
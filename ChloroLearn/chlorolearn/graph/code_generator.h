@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "node.h"
+
+namespace chloro
+{
+    /**
+     * \brief Generates standalone C++ source code evaluating a node of a built graph.
+     * \details The generated source file only depends on the standard library. It contains a function of
+     * the signature <tt>void name(const double* input_0, ..., double* output)</tt>, in which the operators are
+     * evaluated by straight-line loops with all the shapes as literals. Values of variables and constants
+     * are embedded as static arrays, and the results of operators are kept in static buffers, so the function
+     * allocates nothing, but it isn't reentrant either. Reshapes are free, and dropouts are evaluated like in
+     * inference. All the inputs and outputs are in the row-major order of their shapes.
+     * \remark Operators are generated by their kinds recorded by \c Operator::describe, so graphs containing
+     * custom operators can't be generated.
+     */
+    class CodeGenerator final
+    {
+    private:
+        Node* target_;
+        std::vector<Node*> inputs_;
+        std::vector<Node*> nodes_;
+    public:
+        /**
+         * \brief Plan the generation of a node.
+         * \param target The node evaluated by the generated function.
+         * \param inputs The \c Input nodes which the target depends on, in the order of the parameters
+         * of the generated function.
+         */
+        CodeGenerator(Node& target, const std::vector<NodeRef>& inputs);
+        /**
+         * \brief Generate the source code, using the current values of the variables.
+         * \param stream The stream to write the source code into.
+         * \param function_name Name of the generated function.
+         */
+        void generate(std::ostream& stream, const std::string& function_name = "predict") const;
+        /**
+         * \brief Generate the source code into a file.
+         * \param path The full path or relative path to the source file.
+         * \param function_name Name of the generated function.
+         */
+        void generate(const std::string& path, const std::string& function_name = "predict") const;
+    };
+}
@@ -0,0 +1,33 @@
+#include "execution_plan.h"
+#include "graph.h"
+
+namespace chloro
+{
+    ExecutionPlan::ExecutionPlan(Node& target) :target_(&target)
+    {
+        Graph& graph = *target.graph_;
+        for (const size_t id : graph.topological_order(target))
+        {
+            Node& node = graph.nodes_[id];
+            if (node.content_.index() != Node::OperatorType) continue;
+            Step step{ &node, {} };
+            for (const size_t child : graph.childs(id)) step.childs.push_back(&graph.nodes_[child]);
+            steps_.push_back(std::move(step));
+        }
+    }
+
+    const Array<double>& ExecutionPlan::run()
+    {
+        std::vector<char>& value_ready = target_->graph_->value_ready_;
+        for (const Step& step : steps_)
+        {
+            params_.clear();
+            for (Node* child : step.childs) params_.emplace_back(child->value());
+            Node& node = *step.node;
+            node.operator_value_ = node.profiled(ProfilePhase::forward,
+                [&] { return std::get<Node::OperatorType>(node.content_).evaluate(params_); });
+            value_ready[node.id_] = true;
+        }
+        return target_->value();
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "node.h"
+
+namespace chloro
+{
+    /**
+     * \brief A pre-planned evaluation of a node, for running inference repeatedly.
+     * \details The operator nodes which the target depends on are sorted in dependency order once when
+     * planning. Running the plan then evaluates them in a flat loop, without looking up the edges in the
+     * graph or checking which nodes are evaluated already.
+     * \remark The plan refers to the nodes of a graph, so the graph should outlive it.
+     */
+    class ExecutionPlan final
+    {
+    private:
+        struct Step
+        {
+            Node* node;
+            std::vector<Node*> childs;
+        };
+        std::vector<Step> steps_;
+        Node* target_;
+        std::vector<ArrayRef> params_;
+    public:
+        /** \brief Plan the evaluation of a node. */
+        explicit ExecutionPlan(Node& target);
+        /**
+         * \brief Evaluate the target node, using the current values of the input nodes.
+         * \return The value of the target node.
+         */
+        const Array<double>& run();
+        /** \brief Get the amount of operators evaluated in every run. */
+        size_t size() const { return steps_.size(); }
+    };
+}
@@ -1,9 +1,15 @@
+#include <cmath>
+#include <chrono>
 #include <random>
 #include <algorithm>
+#include <optional>
+#include <unordered_map>
 
 #include "graph.h"
 #include "nodes/input.h"
 #include "nodes/variable.h"
+#include "prefetcher.h"
+#include "operator_registry.h"
 #include "../utility/binary_io.h"
 #include "../utility/stopwatch.h"
 
@@ -12,64 +18,201 @@ namespace chloro
     void Graph::input(Node& node, const Array<double>& value) const
     {
         if (node.content_.index() != 0) throw IllegalOperationException("Current node isn't an input node");
+        const MemoryScope scope(MemoryCategory::inputs);
         std::get<0>(node.content_).input(value);
     }
 
-    void Graph::update_dag(Node& node)
+    namespace
     {
-        node.update_time_++;
-        if (node.content_.index() == 3) // Operator
-            for (NodeRef from : node.from_nodes_)
-                update_dag(from.get());
+        std::string operator_label(const OperatorDescriptor& descriptor, const size_t index)
+        {
+            return (descriptor.kind.empty() ? "custom" : descriptor.kind) + "_" + std::to_string(index);
+        }
+    }
+
+    void Graph::pack_parameters()
+    {
+        std::vector<Node*> variables;
+        for (Node& node : nodes_)
+            if (node.content_.index() == 2)
+                variables.push_back(&node);
+        // Check whether the variables are still bound to the current buffer
+        const size_t count = variables.size();
+        bool packed = count == parameters_.parameter_count();
+        for (size_t i = 0; packed && i < count; i++)
+            packed = std::get<Node::VariableType>(variables[i]->content_).value().data().data()
+                == parameters_.value_data(i);
+        if (packed) return;
+        std::vector<ArrayShape> shapes;
+        shapes.reserve(count);
+        for (Node* node : variables) shapes.push_back(node->shape());
+        const MemoryScope scope(MemoryCategory::parameters);
+        ParameterBuffer buffer(shapes);
+        for (size_t i = 0; i < count; i++)
+        {
+            Variable& variable = std::get<Node::VariableType>(variables[i]->content_);
+            Array<double> value = buffer.value_view(i);
+            value.assign(variable.value());
+            variable.bind(std::move(value));
+            variables[i]->gradient_ = buffer.gradient_view(i);
+        }
+        parameters_ = std::move(buffer);
     }
 
+    Node& Graph::add_node(Node&& node, const std::vector<size_t>& childs)
+    {
+        edge_targets_.insert(edge_targets_.end(), childs.begin(), childs.end());
+        edge_offsets_.push_back(edge_targets_.size());
+        value_ready_.push_back(false);
+        Node& result = nodes_.emplace_back(std::move(node));
+        result.graph_ = this;
+        result.id_ = nodes_.size() - 1;
+        return result;
+    }
+
+    ArraySpan<const size_t> Graph::childs(const size_t id) const
+    {
+        return { edge_targets_.data() + edge_offsets_[id], edge_offsets_[id + 1] - edge_offsets_[id] };
+    }
+
+    const std::vector<size_t>& Graph::topological_order(const Node& target)
+    {
+        if (target.graph_ != this) throw IllegalArgumentException("The node doesn't belong to this graph");
+        if (order_target_ == target.id_) return order_;
+        // Childs always have smaller ids than their parents, so marking the dependencies from the target
+        // downwards visits every parent before its childs, and the marked ids are sorted already
+        std::vector<char> needed(target.id_ + 1, false);
+        needed[target.id_] = true;
+        size_t count = 0;
+        for (size_t id = target.id_ + 1; id-- > 0;)
+            if (needed[id])
+            {
+                count++;
+                for (const size_t child : childs(id)) needed[child] = true;
+            }
+        order_.clear();
+        order_.reserve(count);
+        for (size_t id = 0; id <= target.id_; id++)
+            if (needed[id]) order_.push_back(id);
+        order_target_ = target.id_;
+        return order_;
+    }
+
+    const Array<double>& Graph::evaluate(const Node& target, const bool training)
+    {
+        for (const size_t id : topological_order(target))
+        {
+            Node& node = nodes_[id];
+            if (node.content_.index() != Node::OperatorType || value_ready_[id]) continue;
+            operands_.clear();
+            for (const size_t child : childs(id)) operands_.emplace_back(nodes_[child].value());
+            Operator& content = std::get<Node::OperatorType>(node.content_);
+            node.operator_value_ = node.profiled(ProfilePhase::forward, [&]
+                { return training ? content.forward_propagate(operands_) : content.evaluate(operands_); });
+            value_ready_[id] = true;
+        }
+        return target.value();
+    }
+
+    void Graph::clear_nodes()
+    {
+        // Release the memory of the nodes first, so that the ids of their owners can be reused right away
+        std::vector<uint32_t> owners;
+        for (const Node& node : nodes_)
+            if (node.memory_owner_ != 0) owners.push_back(node.memory_owner_);
+        nodes_.clear();
+        for (const uint32_t owner : owners) MemoryTracker::remove_owner(owner);
+        edge_offsets_.assign(1, 0);
+        edge_targets_.clear();
+        value_ready_.clear();
+        order_.clear();
+        order_target_ = size_t(-1);
+        node_names_.clear();
+        node_labels_.clear();
+        variable_ids_.clear();
+        default_variable_count_ = 0;
+    }
+
+    Graph::~Graph() noexcept { clear_nodes(); }
+
     void Graph::forward_propagate(Node& node, std::initializer_list<InputParam> input_params)
     {
         for (const InputParam& input_param : input_params) input(input_param.input, input_param.value);
-        for (Node& graph_node : nodes_) graph_node.value_ready_ = false;
-        node.forward_propagate();
+        std::fill(value_ready_.begin(), value_ready_.end(), false);
+        evaluate(node, true);
     }
 
     Node& Graph::add_input(const ArrayShape& shape)
     {
-        nodes_.emplace_back(Input(shape));
-        return nodes_.back();
+        const MemoryScope scope(MemoryCategory::inputs);
+        return add_node(Node(Input(shape)));
     }
 
-    Node& Graph::add_variable(const ArrayShape& shape)
+    Node& Graph::add_variable(const ArrayShape& shape, const std::string& name)
     {
-        Node& node = nodes_.emplace_back(Variable(shape));
+        std::string unique_name = name;
+        if (unique_name.empty())
+            do unique_name = "variable_" + std::to_string(default_variable_count_++);
+            while (variable_ids_.count(unique_name) != 0);
+        else if (variable_ids_.count(unique_name) != 0)
+            throw IllegalArgumentException("Variable names should be unique in a graph");
+        const MemoryScope scope(MemoryCategory::parameters);
+        Node& node = add_node(Node(Variable(shape, unique_name)));
         node.gradient_ = Array<double>::zeros(shape);
+        variable_ids_.emplace(std::move(unique_name), node.id_);
         return node;
     }
 
     Node& Graph::add_constant(const Array<double>& array)
     {
-        nodes_.emplace_back(Constant(array));
-        return nodes_.back();
+        const MemoryScope scope(MemoryCategory::parameters);
+        return add_node(Node(Constant(array)));
     }
 
     Node& Graph::add_constant(Array<double>&& array)
     {
-        nodes_.emplace_back(Constant(std::move(array)));
-        return nodes_.back();
+        const MemoryScope scope(MemoryCategory::parameters);
+        return add_node(Node(Constant(std::move(array))));
+    }
+
+    Node& Graph::add_shared_constant(const SharedArray<double>& array)
+    {
+        return add_node(Node(Constant(array)));
     }
 
     Node& Graph::add_operator(Operand&& list)
     {
-        std::vector<NodeRef> list_ref;
+        std::vector<size_t> list_ids;
         list.for_each([&](ListedOperator& item)
             {
-                std::vector<NodeRef> from;
+                std::vector<size_t> from;
                 for (ListedOperator::Ref& ref : item.from_nodes)
                     if (ref.index() == 0) // size_t
-                        from.push_back(list_ref[std::get<0>(ref)]);
+                        from.push_back(list_ids[std::get<0>(ref)]);
                     else
-                        from.push_back(std::get<1>(ref));
-                nodes_.emplace_back(Node(std::move(item.content), from));
-                Node& result = nodes_.back();
-                result.gradient_ = Array<double>::zeros(result.shape());
-                list_ref.emplace_back(result);
+                    {
+                        const Node& child = std::get<1>(ref).get();
+                        if (child.graph_ != this)
+                            throw IllegalArgumentException("Operands should be nodes of the same graph");
+                        from.push_back(child.id_);
+                    }
+                const size_t index = nodes_.size();
+                const uint32_t owner = memory_tracking_
+                    ? MemoryTracker::add_owner(operator_label(item.content.descriptor(), index)) : 0;
+                Node& result = add_node(Node(std::move(item.content)), from);
+                result.memory_owner_ = owner;
+                if (memory_tracking_)
+                {
+                    // The state was allocated when the operator was built, before its owner existed
+                    const MemoryScope scope(MemoryCategory::state, owner);
+                    std::get<Node::OperatorType>(result.content_).reallocate_state();
+                }
+                {
+                    const MemoryScope scope(MemoryCategory::gradients, owner);
+                    result.gradient_ = Array<double>::zeros(result.shape());
+                }
+                if (profiler_) profile_node(result);
+                list_ids.push_back(index);
             });
         return nodes_.back();
     }
@@ -77,8 +220,20 @@ namespace chloro
     const Array<double>& Graph::get_value(Node& node, const std::initializer_list<InputParam> input_params)
     {
         for (const InputParam& input_param : input_params) input(input_param.input, input_param.value);
-        for (Node& graph_node : nodes_) graph_node.value_ready_ = false;
-        return node.get_value();
+        std::fill(value_ready_.begin(), value_ready_.end(), false);
+        return evaluate(node, false);
+    }
+
+    void Graph::bind_input(Node& node, const Array<double>& value) const
+    {
+        if (node.content_.index() != 0) throw IllegalOperationException("Current node isn't an input node");
+        std::get<Node::InputType>(node.content_).bind(value);
+    }
+
+    void Graph::bind_shared_input(Node& node, const SharedArray<double>& value) const
+    {
+        if (node.content_.index() != 0) throw IllegalOperationException("Current node isn't an input node");
+        std::get<Node::InputType>(node.content_).bind(value);
     }
 
     void Graph::set_variable(Node& node, const Array<double>& value) const
@@ -88,28 +243,210 @@ namespace chloro
         std::get<Node::VariableType>(node.content_).set_value(value);
     }
 
-    void Graph::optimize_once(Node& target, const std::initializer_list<InputParam> input_params,
-        const Optimizer& optimizer)
+    void Graph::set_accumulation_steps(const size_t steps)
     {
-        if (target.content_.index() != 3) throw IllegalOperationException("Target should be an operator");
+        if (steps == 0) throw IllegalArgumentException("Accumulation steps should be positive");
+        accumulation_steps_ = steps;
+    }
+
+    void Graph::set_prefetch_depth(const size_t depth) { prefetch_depth_ = depth; }
+
+    void Graph::set_backward_arena(const bool enabled)
+    {
+        backward_arena_enabled_ = enabled;
+        if (!enabled) backward_arena_.release();
+    }
+
+    void Graph::back_propagate(Node& target, const Array<double>& gradient)
+    {
+        watermark(memory_watermarks_.backward, [&]
+            {
+                {
+                    // The values outlive the back propagation, so they must never come from its arena
+                    const ArenaScope persistent(nullptr);
+                    evaluate(target, true);
+                }
+                const ArenaScope arena(backward_arena_enabled_ ? &backward_arena_ : nullptr);
+                if (target.content_.index() >= Node::VariableType) target.gradient_ += gradient;
+                // Parents come after their childs in the order, so every gradient is complete when it's
+                // propagated in the reverse order
+                const std::vector<size_t>& order = topological_order(target);
+                for (auto iter = order.rbegin(); iter != order.rend(); ++iter)
+                {
+                    Node& node = nodes_[*iter];
+                    if (node.content_.index() != Node::OperatorType) continue;
+                    const ArraySpan<const size_t> from = childs(*iter);
+                    operands_.clear();
+                    for (const size_t child : from) operands_.emplace_back(nodes_[child].value());
+                    Operator& content = std::get<Node::OperatorType>(node.content_);
+                    std::vector<Array<double>> gradients = node.profiled(ProfilePhase::backward,
+                        [&] { return content.back_propogate(node.gradient_, operands_, node.operator_value_); });
+                    for (size_t i = 0; i < from.size(); i++)
+                    {
+                        Node& child = nodes_[from[i]];
+                        // Back propagation ends at constant values
+                        if (child.content_.index() >= Node::VariableType) child.gradient_ += gradients[i];
+                    }
+                }
+            });
+        backward_arena_.reset();
+    }
+
+    std::string Graph::node_label(const Node& node) const
+    {
+        const auto iter = node_labels_.find(node.id_);
+        if (iter != node_labels_.end()) return iter->second;
+        return operator_label(std::get<Node::OperatorType>(node.content_).descriptor(), node.id_);
+    }
+
+    void Graph::profile_node(Node& node)
+    {
+        node.profiler_ = profiler_;
+        if (node.profile_entry_ != size_t(-1)) return; // Added by an earlier call of set_profiler
+        const OperatorDescriptor& descriptor = std::get<Node::OperatorType>(node.content_).descriptor();
+        const std::string kind = descriptor.kind.empty() ? "custom" : descriptor.kind;
+        std::vector<ArrayShape> childs;
+        for (const size_t child : this->childs(node.id_)) childs.push_back(nodes_[child].shape());
+        const auto [forward, backward] = estimate_cost(descriptor, childs, node.shape());
+        node.profile_entry_ = profiler_->add_entry(node_label(node), kind, { forward, backward });
+    }
+
+    void Graph::set_profiler(Profiler* profiler)
+    {
+        profiler_ = profiler;
+        // Setting the same profiler again only resumes profiling, without adding the entries twice
+        const bool registering = profiler_ && profiler_ != registered_profiler_;
+        if (registering) registered_profiler_ = profiler_;
+        double parameter_size = 0.0;
+        double input_size = 0.0;
         for (Node& node : nodes_)
         {
-            node.update_time_ = 0;
-            node.updated_time_ = 0;
-            node.clear_gradient();
-            node.set_optimizer(optimizer);
+            const double size = double(node.shape().element_count());
+            switch (node.content_.index())
+            {
+            case Node::InputType: input_size += size; break;
+            case Node::VariableType: parameter_size += size; break;
+            case Node::OperatorType:
+                if (registering) node.profile_entry_ = size_t(-1);
+                if (profiler_) profile_node(node);
+                else node.profiler_ = nullptr;
+                break;
+            default: break;
+            }
+        }
+        if (!registering) return;
+        // The optimizer is estimated like SGD, reading the values and the gradients then writing the values
+        std::array<ProfileCost, profile_phase_count> costs{};
+        costs[size_t(ProfilePhase::optimizer)] = { 2 * parameter_size, 3 * parameter_size * sizeof(double) };
+        optimizer_entry_ = profiler_->add_entry("optimizer", "optimizer", costs);
+        costs = {};
+        costs[size_t(ProfilePhase::input)] = { 0.0, 2 * input_size * sizeof(double) };
+        input_entry_ = profiler_->add_entry("input", "input", costs);
+    }
+
+    template <typename Func>
+    void Graph::watermark(size_t& peak, Func&& func)
+    {
+        if (!memory_tracking_)
+        {
+            func();
+            return;
         }
-        update_dag(target);
-        forward_propagate(target, input_params);
-        target.back_propagate(Array<double>::repeats(1.0, target.shape()));
-        for (Node& node : nodes_) node.apply_gradient();
+        MemoryTracker::reset_watermark();
+        func();
+        peak = std::max(peak, MemoryTracker::watermark());
+    }
+
+    MemoryFootprint Graph::memory_footprint() const
+    {
+        MemoryFootprint footprint;
+        for (const Node& node : nodes_)
+        {
+            switch (node.content_.index())
+            {
+            case Node::InputType:
+                footprint.inputs += std::get<Node::InputType>(node.content_).value().size() * sizeof(double);
+                break;
+            case Node::ConstantType:
+                footprint.parameters += std::get<Node::ConstantType>(node.content_).value().size() * sizeof(double);
+                break;
+            case Node::VariableType:
+                footprint.parameters += std::get<Node::VariableType>(node.content_).value().size() * sizeof(double);
+                footprint.gradients += node.gradient_.size() * sizeof(double);
+                break;
+            default:
+                footprint.activations += node.operator_value_.size() * sizeof(double);
+                footprint.gradients += node.gradient_.size() * sizeof(double);
+                footprint.state += std::get<Node::OperatorType>(node.content_).state().size() * sizeof(double);
+                break;
+            }
+        }
+        return footprint;
+    }
+
+    void Graph::set_memory_tracking(const bool enabled)
+    {
+        if (enabled) MemoryTracker::enable();
+        if (enabled && !memory_tracking_)
+        {
+            for (Node& node : nodes_)
+                if (node.content_.index() == Node::OperatorType && node.memory_owner_ == 0)
+                    node.memory_owner_ = MemoryTracker::add_owner(node_label(node));
+        }
+        memory_tracking_ = enabled;
+    }
+
+    void Graph::write_memory_report(std::ostream& stream) const
+    {
+        const MemoryFootprint footprint = memory_footprint();
+        char line[160];
+        const auto write_row = [&](const char* name, const size_t bytes)
+        {
+            std::snprintf(line, sizeof(line), "%-32s %14.3f\n", name, double(bytes) / 1048576);
+            stream << line;
+        };
+        std::snprintf(line, sizeof(line), "%-32s %14s\n", "footprint", "MiB");
+        stream << line;
+        write_row("parameters", footprint.parameters);
+        write_row("inputs", footprint.inputs);
+        write_row("activations", footprint.activations);
+        write_row("gradients", footprint.gradients);
+        write_row("state", footprint.state);
+        write_row("total", footprint.total());
+        if (memory_tracking_)
+        {
+            std::snprintf(line, sizeof(line), "%-32s %14s\n", "watermark", "MiB");
+            stream << line;
+            write_row("forward", memory_watermarks_.forward);
+            write_row("backward", memory_watermarks_.backward);
+            write_row("optimizer", memory_watermarks_.optimizer);
+        }
+        if (MemoryTracker::enabled()) MemoryTracker::write_report(stream);
+    }
+
+    void Graph::optimize_once(Node& target, const std::initializer_list<InputParam> input_params,
+        const Optimizer& optimizer)
+    {
+        if (target.content_.index() != 3) throw IllegalOperationException("Target should be an operator");
+        pack_parameters();
+        parameters_.clear_gradients();
+        for (Node& node : nodes_) node.clear_gradient();
+        watermark(memory_watermarks_.forward, [&] { forward_propagate(target, input_params); });
+        back_propagate(target, Array<double>::repeats(1.0, target.shape()));
+        Optimizer step = optimizer;
+        watermark(memory_watermarks_.optimizer, [&]
+            {
+                const MemoryScope scope(MemoryCategory::optimizer);
+                const Profiler::Mark start = profiler_ ? profiler_->start() : Profiler::Mark();
+                step(parameters_.values(), parameters_.gradients());
+                if (profiler_)
+                    profiler_->record(optimizer_entry_, ProfilePhase::optimizer, start);
+            });
     }
 
     void Graph::optimize(Node& target, const std::initializer_list<InputPack> input_pack,
         const Optimizer& optimizer, const size_t batch_size, Callback&& batch_callback, Callback&& epoch_callback)
     {
-        if (target.content_.index() != 3) throw IllegalOperationException("Target should be an operator");
-        for (Node& node : nodes_) node.updated_time_ = 0;
         size_t epoch_size = 0;
         bool first = true;
         for (const InputPack& item : input_pack)
@@ -121,46 +458,154 @@ namespace chloro
         if (epoch_size == 0)
             throw IllegalOperationException("In order to perform batch updates and count epochs, there must be at least "
                 "one input parameter.");
-        static std::mt19937 generator{ std::random_device{}() };
-        for (Node& node : nodes_)
+        std::vector<std::reference_wrapper<const DataValues>> packs;
+        std::vector<NodeRef> inputs;
+        for (const InputPack& item : input_pack)
+        {
+            packs.emplace_back(item.pack);
+            inputs.emplace_back(item.input);
+        }
+        const PackDataSource source(std::move(packs));
+        optimize(target, source, inputs, optimizer, batch_size, std::move(batch_callback), std::move(epoch_callback));
+    }
+
+    void Graph::optimize(Node& target, const DataSource& source, const std::vector<NodeRef>& inputs,
+        const Optimizer& optimizer, const size_t batch_size, Callback&& batch_callback, Callback&& epoch_callback)
+    {
+        if (target.content_.index() != 3) throw IllegalOperationException("Target should be an operator");
+        const size_t epoch_size = source.size();
+        if (epoch_size == 0)
+            throw IllegalOperationException("In order to perform batch updates and count epochs, there must be at least "
+                "one sample.");
+        const size_t field_count = source.field_count();
+        if (field_count != inputs.size())
+            throw MismatchedSizesException("Every field of the data source should feed an input node");
+        std::vector<std::reference_wrapper<Input>> input_contents;
+        for (const NodeRef input : inputs)
         {
-            node.update_time_ = 0;
-            node.set_optimizer(optimizer);
+            Node& node = input.get();
+            if (node.content_.index() != 0) throw IllegalOperationException("Current node isn't an input node");
+            input_contents.emplace_back(std::get<Node::InputType>(node.content_));
         }
-        update_dag(target);
+        static std::mt19937 generator{ std::random_device{}() };
+        std::optional<InputPrefetcher> prefetcher;
+        if (prefetch_depth_ > 0) prefetcher.emplace(source, input_contents, prefetch_depth_);
+        std::vector<Array<double>> staged(field_count);
+        pack_parameters();
+        Optimizer step = optimizer;
+        const std::vector<size_t> order = topological_order(target);
         const Array<double> ones = Array<double>::repeats(1.0, target.shape());
+        parameters_.clear_gradients();
+        size_t accumulated = 0;
         size_t counter = 0;
+        stop_requested_ = false;
+        using Clock = std::chrono::steady_clock;
+        StepMetrics metrics;
+        double epoch_loss = 0.0;
+        size_t epoch_samples = 0;
+        Clock::time_point batch_start = Clock::now();
         Stopwatch batch_watch;
-        while (true)
+        for (size_t epoch = 0; ; epoch++)
         {
             Stopwatch epoch_watch;
-            std::vector<size_t> permutation(epoch_size);
-            for (size_t i = 0; i < epoch_size; i++) permutation[i] = i;
-            std::shuffle(permutation.begin(), permutation.end(), generator);
+            std::vector<size_t> permutation;
+            if (!prefetcher)
+            {
+                permutation.resize(epoch_size);
+                for (size_t i = 0; i < epoch_size; i++) permutation[i] = i;
+                std::shuffle(permutation.begin(), permutation.end(), generator);
+            }
+            epoch_loss = 0.0;
+            epoch_samples = 0;
             for (size_t i = 0; i < epoch_size; i++)
             {
-                for (Node& node : nodes_)
+                for (const size_t id : order) nodes_[id].clear_gradient();
+                std::fill(value_ready_.begin(), value_ready_.end(), false);
+                // Add the time since the last lap to a phase of the metrics, if they're collected
+                Clock::time_point lap_start = metrics_sink_ ? Clock::now() : Clock::time_point();
+                const auto lap = [&](double& seconds)
+                {
+                    if (!metrics_sink_) return;
+                    const Clock::time_point now = Clock::now();
+                    seconds += std::chrono::duration<double>(now - lap_start).count();
+                    lap_start = now;
+                };
+                const Profiler::Mark input_start = profiler_ ? profiler_->start() : Profiler::Mark();
+                if (prefetcher)
+                    prefetcher->load_next();
+                else
+                    for (size_t j = 0; j < field_count; j++)
+                    {
+                        const MemoryScope scope(MemoryCategory::inputs);
+                        source.fetch(permutation[i], j, staged[j]);
+                        input_contents[j].get().validate(staged[j]);
+                        input_contents[j].get().exchange(staged[j]);
+                    }
+                if (profiler_) profiler_->record(input_entry_, ProfilePhase::input, input_start);
+                lap(metrics.input_seconds);
+                const Array<double>* loss = nullptr;
+                watermark(memory_watermarks_.forward, [&] { loss = &evaluate(target, true); });
+                lap(metrics.forward_seconds);
+                if (metrics_sink_)
                 {
-                    node.clear_gradient();
-                    node.value_ready_ = false;
+                    const double sum = loss->sum();
+                    metrics.loss += sum;
+                    epoch_loss += sum;
+                }
+                back_propagate(target, ones);
+                lap(metrics.backward_seconds);
+                if (++accumulated == accumulation_steps_)
+                {
+                    if (accumulation_steps_ > 1) parameters_.gradients() *= 1.0 / double(accumulation_steps_);
+                    if (metrics_sink_)
+                    {
+                        metrics.gradient_norm = std::sqrt(optimizers::squared_norm(parameters_.gradients()));
+                        metrics.optimizer_steps++;
+                    }
+                    watermark(memory_watermarks_.optimizer, [&]
+                        {
+                            const MemoryScope scope(MemoryCategory::optimizer);
+                            const Profiler::Mark start = profiler_ ? profiler_->start() : Profiler::Mark();
+                            step(parameters_.values(), parameters_.gradients());
+                            if (profiler_)
+                                profiler_->record(optimizer_entry_, ProfilePhase::optimizer, start);
+                        });
+                    lap(metrics.optimizer_seconds);
+                    parameters_.clear_gradients();
+                    accumulated = 0;
                 }
-                for (const InputPack& item : input_pack) input(item.input, item.pack[permutation[i]]);
-                target.forward_propagate();
-                target.back_propagate(ones);
-                for (Node& node : nodes_) node.apply_gradient();
                 counter++;
-                if (counter % batch_size == 0 && batch_callback)
+                epoch_samples++;
+                metrics.samples++;
+                if (counter % batch_size == 0)
                 {
-                    batch_watch.stop();
-                    batch_callback(batch_watch.seconds());
-                    batch_watch.restart();
+                    if (metrics_sink_)
+                    {
+                        const Clock::time_point now = Clock::now();
+                        metrics.epoch = epoch;
+                        metrics.seconds = std::chrono::duration<double>(now - batch_start).count();
+                        metrics.samples_per_second = double(metrics.samples) / metrics.seconds;
+                        metrics.loss /= double(metrics.samples);
+                        metrics.running_loss = epoch_loss / double(epoch_samples);
+                        metrics_sink_(metrics);
+                    }
+                    metrics = { metrics.batch + 1 };
+                    batch_start = Clock::now();
+                    if (batch_callback)
+                    {
+                        batch_watch.stop();
+                        batch_callback(batch_watch.seconds());
+                        batch_watch.restart();
+                    }
                 }
+                if (stop_requested_) return;
             }
             if (epoch_callback)
             {
                 epoch_watch.stop();
                 epoch_callback(epoch_watch.seconds());
             }
+            if (stop_requested_) return;
         }
     }
 
@@ -184,11 +629,11 @@ namespace chloro
             if (node.content_.index() == 2)
             {
                 Variable& variable = std::get<Node::VariableType>(node.content_);
-                ArrayShape shape;
+                std::vector<size_t> shape;
                 read_vector(stream, shape);
                 if (!stream.good())
                     throw IllegalOperationException("Data in the file doesn't match the variable amount in the graph");
-                Array<double> array = Array<double>::zeros(shape);
+                Array<double> array = Array<double>::zeros(ArrayShape(shape.begin(), shape.end()));
                 std::vector<double> values;
                 read_vector(stream, values);
                 array = std::move(values);
@@ -196,4 +641,268 @@ namespace chloro
             }
         stream.close();
     }
+
+    std::vector<CheckpointEntry> Graph::checkpoint_entries() const
+    {
+        std::vector<CheckpointEntry> entries;
+        for (const Node& node : nodes_)
+            if (node.content_.index() == 2)
+            {
+                const Variable& variable = std::get<Node::VariableType>(node.content_);
+                entries.push_back({ variable.name(), variable.value().shape(), variable.value().data().data() });
+            }
+        return entries;
+    }
+
+    void Graph::save_checkpoint(const std::string& path, const Precision precision) const
+    {
+        write_checkpoint(path, checkpoint_entries(), precision);
+    }
+
+    std::future<void> Graph::save_checkpoint_async(const std::string& path, const Precision precision) const
+    {
+        std::vector<CheckpointEntry> entries = checkpoint_entries();
+        size_t total = 0;
+        for (const CheckpointEntry& entry : entries)
+            total += entry.shape.element_count();
+        // Copy all the values into one snapshot, then point the entries to it
+        std::vector<double> snapshot(total);
+        size_t offset = 0;
+        for (CheckpointEntry& entry : entries)
+        {
+            const size_t size = entry.shape.element_count();
+            std::copy(entry.values, entry.values + size, snapshot.begin() + offset);
+            entry.values = snapshot.data() + offset;
+            offset += size;
+        }
+        return std::async(std::launch::async,
+            [path, precision, entries = std::move(entries), snapshot = std::move(snapshot)]
+            { write_checkpoint(path, entries, precision); });
+    }
+
+    void Graph::load_checkpoint(const std::string& path, const bool verify)
+    {
+        auto checkpoint = std::make_shared<const Checkpoint>(path, verify);
+        std::vector<Variable*> variables;
+        for (Node& node : nodes_)
+            if (node.content_.index() == 2)
+            {
+                Variable& variable = std::get<Node::VariableType>(node.content_);
+                if (!checkpoint->contains(variable.name()))
+                    throw IllegalOperationException("A variable in the graph is missing in the checkpoint");
+                if (checkpoint->shape(variable.name()) != variable.value().shape())
+                    throw MismatchedSizesException("Shape of a variable doesn't match that in the checkpoint");
+                variables.push_back(&variable);
+            }
+        // Only bind after everything is checked, so that a failed load leaves the graph unchanged
+        for (Variable* variable : variables)
+        {
+            const std::string& name = variable->name();
+            variable->bind(checkpoint->precision(name) == Precision::float64
+                ? checkpoint->view(name) : checkpoint->read(name));
+        }
+        checkpoint_ = std::move(checkpoint);
+    }
+
+    void Graph::load_checkpoint_chain(const std::string& base_path, const std::vector<std::string>& delta_paths)
+    {
+        std::unordered_map<std::string, Array<double>> values;
+        for (auto& [name, value] : read_checkpoint_chain(base_path, delta_paths))
+            values.emplace(name, std::move(value));
+        std::vector<std::pair<Variable*, Array<double>*>> matched;
+        for (Node& node : nodes_)
+            if (node.content_.index() == 2)
+            {
+                Variable& variable = std::get<Node::VariableType>(node.content_);
+                const auto iter = values.find(variable.name());
+                if (iter == values.end())
+                    throw IllegalOperationException("A variable in the graph is missing in the checkpoint");
+                if (iter->second.shape() != variable.value().shape())
+                    throw MismatchedSizesException("Shape of a variable doesn't match that in the checkpoint");
+                matched.emplace_back(&variable, &iter->second);
+            }
+        for (auto& [variable, value] : matched) variable->set_value(std::move(*value));
+    }
+
+    void Graph::set_name(Node& node, const std::string& name)
+    {
+        if (name.empty()) throw IllegalArgumentException("Node names should not be empty");
+        if (node.graph_ != this) throw IllegalArgumentException("The node doesn't belong to this graph");
+        const auto [iter, inserted] = node_names_.emplace(name, &node);
+        if (!inserted && iter->second != &node) throw IllegalArgumentException("Node names should be unique in a graph");
+        node_labels_[node.id_] = name;
+        if (node.memory_owner_ != 0) MemoryTracker::rename_owner(node.memory_owner_, name);
+    }
+
+    Node& Graph::node(const std::string& name) const
+    {
+        const auto iter = node_names_.find(name);
+        if (iter == node_names_.end()) throw IllegalArgumentException("No node of the name in the graph");
+        return *iter->second;
+    }
+
+    Node& Graph::node(const size_t id)
+    {
+        if (id >= nodes_.size()) throw ArgumentOutOfRangeException("Node id out of range");
+        return nodes_[id];
+    }
+
+    namespace
+    {
+        constexpr uint32_t model_version = 1;
+
+        std::string constant_entry_name(const size_t index) { return "#constant_" + std::to_string(index); }
+
+        void write_shape(ByteWriter& writer, const ArrayShape& shape)
+        {
+            writer.write(uint64_t(shape.size()));
+            for (const size_t length : shape) writer.write(uint64_t(length));
+        }
+
+        ArrayShape read_shape(ByteReader& reader)
+        {
+            const uint64_t dimension = reader.read<uint64_t>();
+            if (dimension > ArrayShape::max_dimension) throw IOException("The model file is invalid");
+            ArrayShape shape;
+            for (size_t i = 0; i < dimension; i++) shape.push_back(size_t(reader.read<uint64_t>()));
+            return shape;
+        }
+    }
+
+    void Graph::save_model(const std::string& path, const Precision precision) const
+    {
+        std::vector<CheckpointEntry> entries;
+        ByteWriter writer;
+        writer.write(model_version);
+        writer.write(uint64_t(nodes_.size()));
+        for (const Node& node : nodes_)
+        {
+            const size_t index = node.id_;
+            writer.write(uint8_t(node.content_.index()));
+            switch (node.content_.index())
+            {
+            case Node::InputType:
+                write_shape(writer, std::get<Node::InputType>(node.content_).shape());
+                break;
+            case Node::ConstantType:
+            {
+                const Array<double>& value = std::get<Node::ConstantType>(node.content_).value();
+                entries.push_back({ constant_entry_name(index), value.shape(), value.data().data() });
+                break;
+            }
+            case Node::VariableType:
+            {
+                const Variable& variable = std::get<Node::VariableType>(node.content_);
+                writer.write_string(variable.name());
+                entries.push_back({ variable.name(), variable.value().shape(), variable.value().data().data() });
+                break;
+            }
+            default:
+            {
+                const Operator& content = std::get<Node::OperatorType>(node.content_);
+                const OperatorDescriptor& descriptor = content.descriptor();
+                if (descriptor.kind.empty())
+                    throw NotImplementedException("Operators without descriptions can't be saved");
+                writer.write_string(descriptor.kind);
+                writer.write(uint64_t(descriptor.attributes.size()));
+                for (const double attribute : descriptor.attributes) writer.write(attribute);
+                const ArraySpan<const size_t> from = childs(index);
+                writer.write(uint64_t(from.size()));
+                for (const size_t child : from) writer.write(uint64_t(child));
+                write_shape(writer, content.shape());
+                break;
+            }
+            }
+        }
+        writer.write(uint64_t(node_names_.size()));
+        for (const auto& [name, node] : node_names_)
+        {
+            writer.write_string(name);
+            writer.write(uint64_t(node->id_));
+        }
+        const std::vector<char>& bytes = writer.bytes();
+        write_checkpoint(path, entries, precision, std::string(bytes.begin(), bytes.end()));
+    }
+
+    void Graph::load_model(const std::string& path, const bool verify)
+    {
+        if (!nodes_.empty()) throw IllegalOperationException("Models can only be loaded into empty graphs");
+        auto checkpoint = std::make_shared<const Checkpoint>(path, verify);
+        const auto load = [&checkpoint](const std::string& name)
+        {
+            return checkpoint->precision(name) == Precision::float64 ? checkpoint->view(name) : checkpoint->read(name);
+        };
+        const std::string& metadata = checkpoint->metadata();
+        ByteReader reader(metadata.data(), metadata.size());
+        try
+        {
+            if (reader.read<uint32_t>() != model_version) throw IOException("Unsupported model version");
+            // Counts are checked against the bytes left before looping, since every item takes some bytes
+            const size_t count = size_t(reader.read<uint64_t>());
+            if (count > reader.remaining()) throw IOException("The model file is invalid");
+            std::vector<Node*> loaded;
+            for (size_t i = 0; i < count; i++)
+            {
+                switch (reader.read<uint8_t>())
+                {
+                case Node::InputType:
+                    loaded.push_back(&add_input(read_shape(reader)));
+                    break;
+                case Node::ConstantType:
+                    loaded.push_back(&add_constant(checkpoint->read(constant_entry_name(i))));
+                    break;
+                case Node::VariableType:
+                {
+                    const std::string name = reader.read_string();
+                    Node& node = add_variable(checkpoint->shape(name), name);
+                    std::get<Node::VariableType>(node.content_).bind(load(name));
+                    loaded.push_back(&node);
+                    break;
+                }
+                case Node::OperatorType:
+                {
+                    const std::string kind = reader.read_string();
+                    const size_t attribute_count = size_t(reader.read<uint64_t>());
+                    if (attribute_count > reader.remaining() / sizeof(double))
+                        throw IOException("The model file is invalid");
+                    std::vector<double> attributes(attribute_count);
+                    for (double& attribute : attributes) attribute = reader.read<double>();
+                    std::vector<Operand> operands;
+                    const size_t operand_count = size_t(reader.read<uint64_t>());
+                    if (operand_count > reader.remaining() / sizeof(uint64_t))
+                        throw IOException("The model file is invalid");
+                    for (size_t j = 0; j < operand_count; j++)
+                    {
+                        const size_t index = size_t(reader.read<uint64_t>());
+                        if (index >= loaded.size()) throw IOException("The model file is invalid");
+                        operands.emplace_back(NodeRef(*loaded[index]));
+                    }
+                    Node& node = add_operator(build_operator(kind, operands, attributes));
+                    if (node.shape() != read_shape(reader))
+                        throw IOException("Shape of a rebuilt operator doesn't match that in the model file");
+                    loaded.push_back(&node);
+                    break;
+                }
+                default: throw IOException("The model file is invalid");
+                }
+            }
+            const size_t name_count = size_t(reader.read<uint64_t>());
+            if (name_count > reader.remaining() / (sizeof(uint32_t) + sizeof(uint64_t)))
+                throw IOException("The model file is invalid");
+            for (size_t i = 0; i < name_count; i++)
+            {
+                const std::string name = reader.read_string();
+                const size_t index = size_t(reader.read<uint64_t>());
+                if (index >= loaded.size()) throw IOException("The model file is invalid");
+                set_name(*loaded[index], name);
+            }
+        }
+        catch (...)
+        {
+            // Leave the graph empty if the model couldn't be loaded
+            clear_nodes();
+            throw;
+        }
+        checkpoint_ = std::move(checkpoint);
+    }
 }
@@ -1,15 +1,26 @@
 #pragma once
 
 #include <string>
-#include <list>
+#include <deque>
+#include <vector>
+#include <unordered_map>
 #include <initializer_list>
 #include <functional>
+#include <memory>
+#include <future>
 
 #include "node.h"
 #include "input_param.h"
 #include "input_pack.h"
 #include "operand.h"
 #include "optimizer.h"
+#include "parameter_buffer.h"
+#include "execution_plan.h"
+#include "step_metrics.h"
+#include "../basic/array_span.h"
+#include "../utility/data_source.h"
+#include "../utility/checkpoint.h"
+#include "../utility/delta_checkpoint.h"
 
 namespace chloro
 {
@@ -19,22 +30,88 @@ namespace chloro
      */
     using Callback = std::function<void(double)>;
 
+    /** \brief Memory held by the nodes of a graph, see \c Graph::memory_footprint. */
+    struct MemoryFootprint final
+    {
+        size_t parameters = 0; /**< \brief Bytes of the values of the variables and the constants. */
+        size_t inputs = 0; /**< \brief Bytes of the values of the input nodes. */
+        size_t activations = 0; /**< \brief Bytes of the values of the operators. */
+        size_t gradients = 0; /**< \brief Bytes of the gradients of the operators and the variables. */
+        size_t state = 0; /**< \brief Bytes of the internal states of the operators. */
+        /** \brief Get the total bytes. */
+        size_t total() const { return parameters + inputs + activations + gradients + state; }
+    };
+
+    /** \brief Peaks of the tracked memory during the passes of training, see \c Graph::set_memory_tracking. */
+    struct MemoryWatermarks final
+    {
+        size_t forward = 0; /**< \brief Peak bytes during forward propagations. */
+        size_t backward = 0; /**< \brief Peak bytes during back propagations. */
+        size_t optimizer = 0; /**< \brief Peak bytes during optimizer steps. */
+    };
+
     /**
      * \brief A class representing a flow graph.
      * \details All computational works are done through manipulations of a \c Graph.
      * All the operations in a graph is lazy-evaluated, that is, the values are calculated
      * every time you call the \c get_value method, but not when you construct the graph.
+     * Nodes are stored in the order they're added and never move, so references to them stay valid as long
+     * as the graph, which can't be copied or moved. The edges are stored in compressed rows indexed by the
+     * ids of the nodes, and the passes sweep the nodes in the order of the ids instead of recursing, so deep
+     * graphs don't overflow the stack.
      */
     class Graph final
     {
+        friend class ExecutionPlan;
+        friend class CodeGenerator;
     private:
-        std::list<Node> nodes_;
+        std::deque<Node> nodes_;
+        // Childs of the node with id i are edge_targets_ from edge_offsets_[i] until edge_offsets_[i + 1]
+        std::vector<size_t> edge_offsets_{ 0 };
+        std::vector<size_t> edge_targets_;
+        std::vector<char> value_ready_;
+        std::vector<ArrayRef> operands_;
+        // Ids of the nodes which the last ordered target depends on, the graph only grows so they never change
+        std::vector<size_t> order_;
+        size_t order_target_ = size_t(-1);
+        ParameterBuffer parameters_;
+        size_t accumulation_steps_ = 1;
+        size_t prefetch_depth_ = 2;
+        std::shared_ptr<const Checkpoint> checkpoint_;
+        std::unordered_map<std::string, Node*> node_names_;
+        std::unordered_map<size_t, std::string> node_labels_; // The latest name given to each node by id
+        std::unordered_map<std::string, size_t> variable_ids_;
+        size_t default_variable_count_ = 0;
+        Profiler* profiler_ = nullptr;
+        Profiler* registered_profiler_ = nullptr; // The profiler which the entries of the graph were added to
+        size_t optimizer_entry_ = 0;
+        size_t input_entry_ = 0;
+        bool memory_tracking_ = false;
+        MemoryWatermarks memory_watermarks_;
+        bool stop_requested_ = false;
+        MetricsSink metrics_sink_;
+        ArrayArena backward_arena_{ size_t(1) << 20, MemoryCategory::gradients };
+        bool backward_arena_enabled_ = true;
+        std::string node_label(const Node& node) const;
+        void profile_node(Node& node);
+        template <typename Func>
+        void watermark(size_t& peak, Func&& func);
         void input(Node& node, const Array<double>& value) const;
-        static void update_dag(Node& node);
+        void pack_parameters();
+        Node& add_node(Node&& node, const std::vector<size_t>& childs = {});
+        ArraySpan<const size_t> childs(size_t id) const;
+        const std::vector<size_t>& topological_order(const Node& target);
+        const Array<double>& evaluate(const Node& target, bool training);
+        void clear_nodes();
         void forward_propagate(Node& node, std::initializer_list<InputParam> input_params = {});
+        void back_propagate(Node& target, const Array<double>& gradient);
     public:
         /** \brief Constructs an empty graph. */
         Graph() = default;
+        Graph(const Graph&) = delete;
+        Graph& operator=(const Graph&) = delete;
+        /** \brief Destructs the graph, removing the memory owners of its nodes, see \c set_memory_tracking. */
+        ~Graph() noexcept;
         /**
          * \brief Add an \c Input node of a specific shape into this graph.
          * \param shape The shape of the added node. Defaults to { 1 } (scalar input).
@@ -45,9 +122,11 @@ namespace chloro
          * \brief Add a \c Variable node of a specific shape into this graph.
          * \details The variable will be initialized to zero.
          * \param shape The shape of the added node. Defaults to { 1 } (scalar input).
+         * \param name The name of the variable used in checkpoints, which should be unique in the graph.
+         * Defaults to "variable_" followed by a counter, skipping the names already in use.
          * \return A reference to the added node.
          */
-        Node& add_variable(const ArrayShape& shape = { 1 });
+        Node& add_variable(const ArrayShape& shape = { 1 }, const std::string& name = {});
         /**
          * \brief Add a \c Constant node containing a constant array into this graph.
          * \param array The constant value of the node.
@@ -60,6 +139,12 @@ namespace chloro
          * \return A reference to the added node.
          */
         Node& add_constant(Array<double>&& array);
+        /**
+         * \brief Add a \c Constant node sharing the values of a shared array, without copying them.
+         * \param array The shared constant value of the node.
+         * \return A reference to the added node.
+         */
+        Node& add_shared_constant(const SharedArray<double>& array);
         /**
          * \brief Add an \c Operand into this graph.
          * \param list The temporary \c Operand to add into the graph.
@@ -79,6 +164,28 @@ namespace chloro
          * \return The result of the evaluation.
          */
         const Array<double>& get_value(Node& node, std::initializer_list<InputParam> input_params = {});
+        /**
+         * \brief Bind an array to an \c Input node without copying its values.
+         * \details The shape of the array is checked once when binding, then every following evaluation or
+         * optimization reads the values directly from the array, until another value is input into the node.
+         * Useful for large inputs living in caller owned memory, like views of a dataset shard. The array
+         * itself is referenced, so it should be kept alive as well as its memory.
+         * \param node The \c Input node to bind.
+         * \param value The bound array, which should outlive the passes using it and keep its shape.
+         */
+        void bind_input(Node& node, const Array<double>& value) const;
+        /** \brief Temporaries can't outlive the passes, move them into a shared array for \c bind_shared_input. */
+        void bind_input(Node& node, Array<double>&& value) const = delete;
+        /** \brief Temporaries can't outlive the passes, bind a shared array with \c bind_shared_input instead. */
+        void bind_input(Node& node, SharedArray<double>&& value) const = delete;
+        /**
+         * \brief Bind a shared array to an \c Input node without copying its values.
+         * \details Works like binding an array, except that the node keeps a reference to the values, so the
+         * shared array doesn't need to outlive the passes using it.
+         * \param node The \c Input node to bind.
+         * \param value The bound shared array.
+         */
+        void bind_shared_input(Node& node, const SharedArray<double>& value) const;
         /**
          * \brief Explicitly set the value of a \c Variable node. Can be used in order to customize graph
          * saving and loading.
@@ -86,6 +193,80 @@ namespace chloro
          * \param value The value to set the node to.
          */
         void set_variable(Node& node, const Array<double>& value) const;
+        /**
+         * \brief Set how many samples the gradients are accumulated over before the optimizer is applied in
+         * \c optimize.
+         * \details The accumulated gradients are averaged, so that accumulating over \a steps samples works like
+         * a mini-batch of size \a steps, without keeping the whole batch in memory. Defaults to 1, which applies
+         * the optimizer after every sample.
+         * \param steps The amount of samples, should be positive.
+         */
+        void set_accumulation_steps(size_t steps);
+        /**
+         * \brief Set how many samples are prepared ahead on a background thread in \c optimize.
+         * \details While a step is computed, a worker thread shuffles the input packs, checks the shapes of
+         * the next samples and copies them into reusable staging buffers, which are then swapped into the
+         * \c Input nodes without copying. Defaults to 2 (double buffering).
+         * \param depth The amount of staged samples, 0 for preparing the inputs on the training thread.
+         */
+        void set_prefetch_depth(size_t depth);
+        /**
+         * \brief Profile the operators, the optimizer and the input loading of this graph.
+         * \details Every operator node becomes an entry of the profiler, named by the name given by \c set_name
+         * when it's added to the profiler, or by its kind and index. Every evaluation, forward propagation and
+         * back propagation of it is then timed. Setting a profiler adds the entries of the operators in the
+         * graph, and operators added afterwards are added as well. Setting the profiler which the entries were
+         * last added to again, like after stopping profiling, resumes it without adding the entries twice. When
+         * no profiler is set, the cost is only a branch per node.
+         * \param profiler The profiler, which should outlive its use in this graph, or \c nullptr to stop
+         * profiling.
+         */
+        void set_profiler(Profiler* profiler);
+        /**
+         * \brief Collect the metrics of every batch of training in \c optimize, see \c StepMetrics.
+         * \details The sink is called after every \a batch_size samples, before the batch callback. Without a
+         * sink, no metrics are collected, and the cost is only a branch per phase of every sample.
+         * \param sink The sink, like one from \c metrics_sinks, or \c nullptr to stop collecting.
+         */
+        void set_metrics_sink(MetricsSink sink) { metrics_sink_ = std::move(sink); }
+        /**
+         * \brief Set whether the temporary arrays of back propagation are allocated from an arena.
+         * \details The arrays created by the backward functions of the operators are only needed until the
+         * gradients are added to the childs, so they're drawn from an \c ArrayArena which is reset after every
+         * back propagation, instead of being allocated from the heap one by one. Enabled by default.
+         * \remark With the arena enabled, backward functions of custom operators must not keep the arrays they
+         * create beyond the call, other than by writing their values into the state of the operator.
+         * \param enabled Whether to use the arena. Disabling it also frees its memory.
+         */
+        void set_backward_arena(bool enabled = true);
+        /**
+         * \brief Get the memory held by the nodes of this graph.
+         * \details Counts the values and gradients which live as long as the nodes, which makes the base
+         * footprint of training the graph. Temporaries and the states of optimizers are not included, track
+         * them with \c set_memory_tracking.
+         */
+        MemoryFootprint memory_footprint() const;
+        /**
+         * \brief Track the memory allocated by the nodes of this graph.
+         * \details Enables the \c MemoryTracker, and makes every operator node an owner of it, named like in
+         * \c set_profiler, so that the allocations of evaluating and back propagating it are attributed to the
+         * node. Allocations of the passes are also categorized, like activations, gradients, inputs or the
+         * optimizer. While tracking, \c optimize_once and \c optimize record the peaks of the passes in
+         * \c memory_watermarks. Owners follow the names given by \c set_name later, and are removed when the
+         * graph is destroyed.
+         * \param enabled Whether to track the memory. Disabling it stops recording the watermarks, but leaves
+         * the tracker enabled, as other graphs may be tracked.
+         */
+        void set_memory_tracking(bool enabled = true);
+        /** \brief Get the peaks of the tracked memory during the passes of training. */
+        const MemoryWatermarks& memory_watermarks() const { return memory_watermarks_; }
+        /** \brief Reset the watermarks to zero. */
+        void reset_memory_watermarks() { memory_watermarks_ = {}; }
+        /**
+         * \brief Write a report of the memory footprint, the watermarks and the usages of the
+         * \c MemoryTracker.
+         */
+        void write_memory_report(std::ostream& stream) const;
         /**
          * \brief Optimize the target once using gradient descent method.
          * \param target The target \c Operator node to minimize.
@@ -105,6 +286,26 @@ namespace chloro
         void optimize(Node& target, std::initializer_list<InputPack> input_pack,
             const Optimizer& optimizer, size_t batch_size, Callback&& batch_callback = nullptr,
             Callback&& epoch_callback = nullptr);
+        /**
+         * \brief Optimize the target several times using SGD (stochastic gradient descent) method, consuming
+         * samples from a data source.
+         * \param target The target \c Operator node to minimize.
+         * \param source The data source, which should outlive the optimization.
+         * \param inputs The \c Input nodes fed by the fields of the data source, in the order of the fields.
+         * \param optimizer The optimizer that will be used.
+         * \param batch_size How many times to perform the SGD method.
+         * \param batch_callback A callback function that will be called after every batch is finished.
+         * \param epoch_callback A callback function that will be called after every epoch is finished.
+         */
+        void optimize(Node& target, const DataSource& source, const std::vector<NodeRef>& inputs,
+            const Optimizer& optimizer, size_t batch_size, Callback&& batch_callback = nullptr,
+            Callback&& epoch_callback = nullptr);
+        /**
+         * \brief Make the running \c optimize return, usually called from its batch or epoch callback.
+         * \details The optimization stops after the current sample. Gradients accumulated but not applied yet
+         * are discarded.
+         */
+        void stop_optimizing() { stop_requested_ = true; }
         /**
          * \brief Save current values of variables in the graph to a data file.
          * \param path The full path or relative path to the data file.
@@ -115,5 +316,79 @@ namespace chloro
          * \param path The full path or relative path to the data file.
          */
         void load_variables(const std::string& path);
+        /**
+         * \brief Save current values of variables in the graph to a checkpoint file.
+         * \details Variables are stored by their names, see \c write_checkpoint for the file format.
+         * \param path The full path or relative path to the checkpoint file.
+         * \param precision Precision of the stored values, reduced precisions make smaller files.
+         */
+        void save_checkpoint(const std::string& path, Precision precision = Precision::float64) const;
+        /**
+         * \brief Save current values of variables in the graph to a checkpoint file on a background thread.
+         * \details The values are copied into a snapshot before this method returns, so the graph can be
+         * trained or modified while the snapshot is being written. The future should be kept, as destroying it
+         * waits for the write. Concurrent saves to the same path don't interfere, the last one finished wins.
+         * \param path The full path or relative path to the checkpoint file.
+         * \param precision Precision of the stored values, reduced precisions make smaller files.
+         * \return A future which becomes ready when the file is written, and rethrows any error of writing it.
+         */
+        [[nodiscard]] std::future<void> save_checkpoint_async(const std::string& path,
+            Precision precision = Precision::float64) const;
+        /**
+         * \brief Load values of variables in the graph from a checkpoint file.
+         * \details Variables are matched by their names. The file is memory mapped and the variables stored
+         * in double precision view the mapped values directly, so loading takes no copying. The mapping is
+         * copy-on-write, training the graph afterwards never modifies the file. Variables stored in reduced
+         * precisions are converted into doubles.
+         * \param path The full path or relative path to the checkpoint file.
+         * \param verify Whether to check the checksums of the values.
+         */
+        void load_checkpoint(const std::string& path, bool verify = true);
+        /**
+         * \brief Get the variables in the graph as checkpoint entries, which point to the current values.
+         * \details Useful for writing checkpoints in other ways, like delta checkpoints:
+         * <tt>writer.write(graph.checkpoint_entries())</tt>. The entries are invalidated when the graph
+         * is optimized or variables are added.
+         */
+        std::vector<CheckpointEntry> checkpoint_entries() const;
+        /**
+         * \brief Load values of variables in the graph from a chain of delta checkpoints.
+         * \param base_path The full path or relative path to the base checkpoint file.
+         * \param delta_paths Paths to the delta files in the order they were written.
+         * \see DeltaCheckpointWriter
+         */
+        void load_checkpoint_chain(const std::string& base_path, const std::vector<std::string>& delta_paths);
+        /**
+         * \brief Give a node a name, so that it can be found by \c node after saving and loading the graph.
+         * \details Usually the inputs and outputs of a model are named, for serving the model.
+         * \param node The node to name.
+         * \param name The name, which should be unique in the graph.
+         */
+        void set_name(Node& node, const std::string& name);
+        /** \brief Find a node by the name given by \c set_name. */
+        Node& node(const std::string& name) const;
+        /** \brief Get a node by its id, see \c Node::id. */
+        Node& node(size_t id);
+        /** \brief Get the amount of nodes in the graph. */
+        size_t node_count() const { return nodes_.size(); }
+        /**
+         * \brief Save the whole graph, including the nodes, the operators and the values of the variables and
+         * the constants, into a model file.
+         * \details The model file is a checkpoint file, of which the metadata describes the structure of the
+         * graph. Operators are saved by their kinds and attributes, so all of them should be described, see
+         * \c Operator::describe.
+         * \param path The full path or relative path to the model file.
+         * \param precision Precision of the stored values, reduced precisions make smaller files.
+         */
+        void save_model(const std::string& path, Precision precision = Precision::float64) const;
+        /**
+         * \brief Load a model file saved by \c save_model into this graph, which should be empty.
+         * \details The operators are rebuilt from the kinds registered with \c register_operator, and the
+         * variables view the memory mapped values like \c load_checkpoint. Named nodes can then be found by
+         * \c node, and planned for repeated inference with \c ExecutionPlan.
+         * \param path The full path or relative path to the model file.
+         * \param verify Whether to check the checksums of the values.
+         */
+        void load_model(const std::string& path, bool verify = true);
     };
 }
@@ -4,15 +4,16 @@
 #include <variant>
 #include <functional>
 
-#include "optimizer.h"
 #include "nodes/input.h"
 #include "nodes/constant.h"
 #include "nodes/variable.h"
 #include "nodes/operator.h"
+#include "profiler.h"
 
 namespace chloro
 {
     class Node;
+    class Graph;
 
     using NodeRef = std::reference_wrapper<Node>;
     using ArrayRef = std::reference_wrapper<const Array<double>>;
@@ -24,10 +25,14 @@ namespace chloro
      * methods of class \c Graph instead. Nodes can contain contents of types including \c Input, \c
      * Constant, \c Variable and \c Operator. For more information on these four node types, please
      * refer to their own documentation and implementation respectively.
+     * Nodes are numbered densely in the order they're added into their graph, and the edges between them
+     * are kept by the graph, see \c id.
      */
     class Node final
     {
         friend class Graph;
+        friend class ExecutionPlan;
+        friend class CodeGenerator;
     private:
         enum VariantType
         {
@@ -38,34 +43,48 @@ namespace chloro
         };
         Array<double> operator_value_;
         Array<double> gradient_;
-        Optimizer optimizer_;
-        bool value_ready_ = false;
-        int update_time_ = 0;
-        int updated_time_ = 0;
-        std::vector<NodeRef> from_nodes_;
+        Graph* graph_ = nullptr;
+        size_t id_ = 0;
         std::variant<Input, Constant, Variable, Operator> content_;
-        void set_optimizer(const Optimizer& optimizer);
+        Profiler* profiler_ = nullptr;
+        size_t profile_entry_ = size_t(-1); // Entry in the profiler registered by the graph, if added
+        uint32_t memory_owner_ = 0;
+        // Time a phase of the operator if profiled, costing only a branch otherwise, and attribute the
+        // allocations in it to this node
+        template <typename Func>
+        auto profiled(const ProfilePhase phase, Func&& func)
+        {
+            const MemoryScope scope(phase == ProfilePhase::backward ? MemoryCategory::gradients
+                : MemoryCategory::activations, memory_owner_);
+            if (!profiler_) return func();
+            const Profiler::Mark start = profiler_->start();
+            auto result = func();
+            profiler_->record(profile_entry_, phase, start);
+            return result;
+        }
         void clear_gradient();
-        void apply_gradient();
-        const Array<double>& get_value();
-        const Array<double>& forward_propagate();
-        void back_propagate(const Array<double>& gradient);
+        const Array<double>& value() const;
     public:
         Node() = delete;
         Node(Node&&) = default; /**< \brief Move constructor. */
         explicit Node(Input& content) = delete;
         explicit Node(Constant& content) = delete;
         explicit Node(Variable& content) = delete;
-        explicit Node(Operator& content, const std::vector<NodeRef>&) = delete;
+        explicit Node(Operator& content) = delete;
         /** \brief Move construct a node of content type \c Input. */
-        explicit Node(Input&& content) :content_(content) {}
+        explicit Node(Input&& content) :content_(std::move(content)) {}
         /** \brief Move construct a node of content type \c Constant. */
-        explicit Node(Constant&& content) :content_(content) {}
+        explicit Node(Constant&& content) :content_(std::move(content)) {}
         /** \brief Move construct a node of content type \c Variable. */
-        explicit Node(Variable&& content) :content_(content) {}
-        /** \brief Move construct a node of content type \c Operator, and link up the nodes. */
-        explicit Node(Operator&& content, const std::vector<NodeRef>& from_nodes) :from_nodes_(from_nodes), content_(content) {}
+        explicit Node(Variable&& content) :content_(std::move(content)) {}
+        /** \brief Move construct a node of content type \c Operator, the graph links it up with its childs. */
+        explicit Node(Operator&& content) :content_(std::move(content)) {}
         /** \brief Get the shape of the node content. */
         const ArrayShape& shape();
+        /**
+         * \brief Get the index of this node in its graph, counting from 0 in the order the nodes are added.
+         * \details Childs of an operator are always added before it, so their indices are smaller.
+         */
+        size_t id() const { return id_; }
     };
 }
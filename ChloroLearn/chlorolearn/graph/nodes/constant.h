@@ -1,25 +1,31 @@
 #pragma once
 
-#include "../../basic/array.h"
+#include "../../basic/shared_array.h"
 
 namespace chloro
 {
     /**
      * \brief This kind of node content holds a constant array value, which can be queried
      * later in the evaluating process.
+     * \details The value is kept as a \c SharedArray, so constants made from the same shared array, like
+     * the constants of several copies of a model, store the values only once.
      * \remark Back-propagation won't pass to this kind of node.
      */
     class Constant final
     {
     private:
-        Array<double> value_;
+        SharedArray<double> value_;
     public:
         Constant() = delete;
         /** \brief Construct a constant with the value. */
         explicit Constant(const Array<double>& value) :value_(value) {}
         /** \brief Move construct a value into the constant. */
-        explicit Constant(Array<double>&& value) :value_(value) {}
+        explicit Constant(Array<double>&& value) :value_(std::move(value)) {}
+        /** \brief Construct a constant sharing the values of a shared array. */
+        explicit Constant(SharedArray<double> value) :value_(std::move(value)) {}
         /** \brief Get the value saved in this constant. */
-        const Array<double>& value() const { return value_; }
+        const Array<double>& value() const { return value_.get(); }
+        /** \brief Get the value saved in this constant as a shared array, for sharing it with other constants. */
+        const SharedArray<double>& shared_value() const { return value_; }
     };
 }
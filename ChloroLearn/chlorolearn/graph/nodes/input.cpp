@@ -4,18 +4,45 @@
 namespace chloro
 {
     void Input::input(const Array<double>& input_value)
+    {
+        validate(input_value);
+        // Reuse the storage of the previous input if possible
+        if (!value_.is_view() && value_.shape() == input_value.shape())
+            value_.assign(input_value);
+        else
+            value_ = input_value;
+        bound_ = nullptr;
+        shared_.reset();
+    }
+
+    void Input::bind(const Array<double>& input_value)
+    {
+        validate(input_value);
+        bound_ = &input_value;
+        shared_.reset();
+    }
+
+    void Input::bind(const SharedArray<double>& input_value)
+    {
+        validate(input_value.get());
+        shared_ = input_value;
+        bound_ = &shared_->get();
+    }
+
+    void Input::validate(const Array<double>& input_value) const
     {
         const size_t dimension = input_value.dimension();
+        if (dimension > shape_.size()) throw MismatchedSizesException("Input size doesn't match node size");
         for (size_t i = 0; i < dimension; i++)
             if (input_value.length_at(i) != shape_[i])
                 throw MismatchedSizesException("Input size doesn't match node size");
-        value_ = input_value;
     }
 
     const Array<double>& Input::value() const
     {
-        if (value_.size() == 0)
+        const Array<double>& value = bound_ ? *bound_ : value_;
+        if (value.size() == 0)
             throw EmptyValueException("There's no value in this node");
-        return value_;
+        return value;
     }
 }
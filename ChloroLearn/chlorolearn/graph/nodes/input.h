@@ -1,6 +1,8 @@
 #pragma once
 
-#include "../../basic/array.h"
+#include <optional>
+
+#include "../../basic/shared_array.h"
 
 namespace chloro
 {
@@ -15,11 +17,36 @@ namespace chloro
     private:
         ArrayShape shape_;
         Array<double> value_;
+        const Array<double>* bound_ = nullptr; // The bound array, read instead of value_ while set
+        std::optional<SharedArray<double>> shared_; // Keeps the values of a bound shared array alive
     public:
         /** \brief Constructs an \c Input object of some specific shape. */
         explicit Input(const ArrayShape& shape) :shape_(shape) {}
         /** \brief Input a value into this object. */
         void input(const Array<double>& input_value);
+        /**
+         * \brief Let this object reference an array instead of copying its values.
+         * \details The shape of the array is checked once here, and the array is read directly in the
+         * following passes, until another array is input or bound.
+         * \param input_value The bound array, which should outlive the passes reading this object and keep
+         * its shape.
+         */
+        void bind(const Array<double>& input_value);
+        void bind(Array<double>&&) = delete; /**< \brief Temporaries can't outlive the passes. */
+        /** \brief Let this object reference the values of a shared array, keeping them alive while bound. */
+        void bind(const SharedArray<double>& input_value);
+        /** \brief Check whether an array could be input into this object, throws if it couldn't. */
+        void validate(const Array<double>& input_value) const;
+        /**
+         * \brief Swap the current saved value with an array without copying it.
+         * \remark The array should have been checked with \c validate.
+         */
+        void exchange(Array<double>& input_value)
+        {
+            std::swap(value_, input_value);
+            bound_ = nullptr;
+            shared_.reset();
+        }
         /** \brief Get the current saved value in this object. */
         const Array<double>& value() const;
         /** \brief Get the shape of the underlying array. */
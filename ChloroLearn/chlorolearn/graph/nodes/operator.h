@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <functional>
 
 #include "../../basic/array.h"
@@ -12,6 +13,18 @@ namespace chloro
     using Forward = std::function<OutParam(ForwardParams)>;
     using Backward = std::function<OutParams(BackwardParams)>;
 
+    /**
+     * \brief Describes what an operator computes, so that it can be serialized and rebuilt.
+     * \details Operators are made of closures, which can't be saved. Instead, the built-in operators
+     * record their kind (the name of the function creating them, like "add") and the non-array arguments
+     * of the function as attributes, for example the axis of a reduction or the stride of a convolution.
+     */
+    struct OperatorDescriptor final
+    {
+        std::string kind; /**< \brief Kind of the operator, empty for custom operators. */
+        std::vector<double> attributes; /**< \brief Non-array arguments, the meanings depend on the kind. */
+    };
+
     /**
      * \brief This kind of node content holds a lazy-evaluated operation.
      * \details This class is the heart of this library. The other three types of nodes only contains
@@ -35,6 +48,7 @@ namespace chloro
         Forward forward_;
         Backward backward_;
         ArrayShape shape_;
+        OperatorDescriptor descriptor_;
     public:
         Operator() = delete;
         /**
@@ -70,6 +84,21 @@ namespace chloro
         }
         /** \brief Get the shape of the evaluation result. */
         const ArrayShape& shape() const { return shape_; }
+        /** \brief Get the internal state of this operator. */
+        const Array<double>& state() const { return state_; }
+        /** \brief Copy the state array to a new allocation, attributed to the current \c MemoryScope. */
+        void reallocate_state() { state_ = Array<double>(state_); }
+        /** \brief Get the description of this operator. */
+        const OperatorDescriptor& descriptor() const { return descriptor_; }
+        /**
+         * \brief Describe this operator for serialization.
+         * \param kind Kind of the operator, which should be registered for loading saved models.
+         * \param attributes Non-array arguments needed for rebuilding the operator.
+         */
+        void describe(std::string kind, std::vector<double> attributes = {})
+        {
+            descriptor_ = { std::move(kind), std::move(attributes) };
+        }
         /**
          * \brief Evaluates this node given the values of its childs.
          * \param params Evaluated values of child nodes.
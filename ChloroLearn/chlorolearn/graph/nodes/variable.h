@@ -1,6 +1,9 @@
 #pragma once
 
 #include <vector>
+#include <string>
+
+#include "../../basic/array.h"
 
 namespace chloro
 {
@@ -13,19 +16,45 @@ namespace chloro
     {
     private:
         Array<double> value_;
+        std::string name_;
     public:
         Variable() = delete;
         /**
          * \brief Construct a variable with the specific array size, and initialize the value
          * of it to zero.
+         * \param size Shape of the variable.
+         * \param name Name of the variable, used for identifying it in checkpoints.
          */
-        explicit Variable(const ArrayShape& size) :value_(Array<double>::zeros(size)) {}
+        explicit Variable(const ArrayShape& size, std::string name = {}) :
+            value_(Array<double>::zeros(size)), name_(std::move(name)) {}
+        /** \brief Get the name of this variable. */
+        const std::string& name() const { return name_; }
         /** \brief Get current value of this variable. */
         const Array<double>& value() const { return value_; }
-        /** \brief Explicitly set the value of this variable to some array. */
-        void set_value(const Array<double>& value) { value_ = value; }
+        /** \brief Get a mutable reference to the value of this variable, used for updating it in place. */
+        Array<double>& value() { return value_; }
+        /**
+         * \brief Explicitly set the value of this variable to some array.
+         * \details If the shape of the array matches that of the variable, the values are copied into
+         * the existing storage, which may be a view of a parameter buffer.
+         */
+        void set_value(const Array<double>& value)
+        {
+            if (value.shape() == value_.shape())
+                value_.assign(value);
+            else
+                value_ = value;
+        }
         /** \brief Explicitly set the value of this variable by moving in some array. */
-        void set_value(Array<double>&& value) { value_ = std::move(value); }
+        void set_value(Array<double>&& value)
+        {
+            if (value.shape() == value_.shape())
+                value_.assign(value);
+            else
+                value_ = std::move(value);
+        }
+        /** \brief Replace the storage of this variable, for example with a view of a parameter buffer. */
+        void bind(Array<double>&& storage) { value_ = std::move(storage); }
         /** \brief Subtract an array value from current value element-wisely. */
         void subtract_from_current(const Array<double>& decrement) { value_ -= decrement; }
     };
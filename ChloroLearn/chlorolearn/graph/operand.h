@@ -85,12 +85,15 @@ namespace chloro
             size_t sum = 0;
             for (size_t i = 0; i < param_size; i++)
             {
-                new_refs.push_back(operands[i].root_node());
                 if (i > 0)
                 {
                     sum += operands[i - 1].data_.size();
                     operands[i].offset_all(sum);
                 }
+                // Indices of the roots are local to the operands, so they are offset as well
+                Ref root = operands[i].root_node();
+                if (root.index() == 0) root = std::get<0>(root) + sum; // size_t
+                new_refs.push_back(root);
             }
             Operand result;
             std::vector<ListedOperator>& data = result.data_;
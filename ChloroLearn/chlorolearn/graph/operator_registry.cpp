@@ -0,0 +1,135 @@
+#include <mutex>
+#include <unordered_map>
+
+#include "operator_registry.h"
+#include "operators.h"
+
+namespace chloro
+{
+    namespace
+    {
+        struct Registration
+        {
+            size_t arity;
+            OperatorFactory factory;
+        };
+
+        using Registry = std::unordered_map<std::string, Registration>;
+
+        double attribute(const std::vector<double>& attributes, const size_t index)
+        {
+            if (index >= attributes.size()) throw IllegalArgumentException("Missing attributes of the operator");
+            return attributes[index];
+        }
+
+        size_t size_attribute(const std::vector<double>& attributes, const size_t index)
+        {
+            return size_t(attribute(attributes, index));
+        }
+
+        ArrayShape shape_attribute(const std::vector<double>& attributes)
+        {
+            if (attributes.empty()) throw IllegalArgumentException("Missing attributes of the operator");
+            return ArrayShape(attributes.begin(), attributes.end());
+        }
+
+        template <typename Func>
+        OperatorFactory unary(Func func)
+        {
+            return [func](std::vector<Operand>& operands, const std::vector<double>&)
+            { return func(std::move(operands[0])); };
+        }
+
+        template <typename Func>
+        OperatorFactory binary(Func func)
+        {
+            return [func](std::vector<Operand>& operands, const std::vector<double>&)
+            { return func(std::move(operands[0]), std::move(operands[1])); };
+        }
+
+        Registry built_in_operators()
+        {
+            using namespace operators;
+            Registry registry;
+            registry["identity"] = { 1, unary(identity) };
+            registry["add"] = { 2, binary(add) };
+            registry["subtract"] = { 2, binary(subtract) };
+            registry["multiply"] = { 2, binary(multiply) };
+            registry["divide"] = { 2, binary(divide) };
+            registry["matrix_multiply"] = { 2, binary(matrix_multiply) };
+            registry["relu"] = { 1, unary(relu) };
+            registry["leaky_relu"] = { 1, unary(leaky_relu) };
+            registry["sigmoid"] = { 1, unary(sigmoid) };
+            registry["softmax"] = { 1, unary(softmax) };
+            registry["categorical_cross_entropy"] = { 2, binary(categorical_cross_entropy) };
+            registry["repeat"] = { 1, [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                { return repeat(std::move(operands[0]), shape_attribute(attributes)); } };
+            registry["reshape"] = { 1, [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                {
+                    const ArrayShape shape = shape_attribute(attributes);
+                    return reshape(std::move(operands[0]), DefaultableArrayShape(shape.begin(), shape.end()));
+                } };
+            registry["sum"] = { 1, [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                {
+                    if (attributes.empty()) return sum(std::move(operands[0]));
+                    return sum(std::move(operands[0]), size_attribute(attributes, 0));
+                } };
+            registry["mean"] = { 1, [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                { return mean(std::move(operands[0]), size_attribute(attributes, 0)); } };
+            registry["max"] = { 1, [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                { return max(std::move(operands[0]), size_attribute(attributes, 0)); } };
+            registry["argmax"] = { 1, [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                { return argmax(std::move(operands[0]), size_attribute(attributes, 0)); } };
+            registry["power"] = { 1, [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                { return power(std::move(operands[0]), attribute(attributes, 0)); } };
+            registry["exp"] = { 1, [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                { return exp(std::move(operands[0]), attribute(attributes, 0)); } };
+            registry["convolution_2d_with_padding"] = { 2,
+                [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                {
+                    return convolution_2d_with_padding(std::move(operands[0]), std::move(operands[1]),
+                        { size_attribute(attributes, 0), size_attribute(attributes, 1) });
+                } };
+            registry["max_pool_2d"] = { 1, [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                {
+                    return max_pool_2d(std::move(operands[0]),
+                        { size_attribute(attributes, 0), size_attribute(attributes, 1) },
+                        { size_attribute(attributes, 2), size_attribute(attributes, 3) });
+                } };
+            registry["dropout"] = { 1, [](std::vector<Operand>& operands, const std::vector<double>& attributes)
+                { return dropout(std::move(operands[0]), attribute(attributes, 0)); } };
+            return registry;
+        }
+
+        std::mutex registry_mutex;
+
+        Registry& registry()
+        {
+            static Registry registry = built_in_operators();
+            return registry;
+        }
+    }
+
+    void register_operator(const std::string& kind, const size_t arity, OperatorFactory factory)
+    {
+        if (kind.empty()) throw IllegalArgumentException("Operator kind should not be empty");
+        std::lock_guard lock(registry_mutex);
+        registry()[kind] = { arity, std::move(factory) };
+    }
+
+    Operand build_operator(const std::string& kind, std::vector<Operand>& operands,
+        const std::vector<double>& attributes)
+    {
+        Registration registration;
+        {
+            std::lock_guard lock(registry_mutex);
+            const Registry& operators = registry();
+            const auto iter = operators.find(kind);
+            if (iter == operators.end()) throw IllegalArgumentException("Unknown operator kind");
+            registration = iter->second;
+        }
+        if (operands.size() != registration.arity)
+            throw MismatchedSizesException("Amount of operands doesn't match the arity of the operator");
+        return registration.factory(operands, attributes);
+    }
+}
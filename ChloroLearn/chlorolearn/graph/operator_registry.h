@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "operand.h"
+
+namespace chloro
+{
+    /**
+     * \brief A function rebuilding an operator of some kind from its operands and attributes.
+     * \details The operands are the child nodes of the saved operator in order, and the attributes are those
+     * recorded by \c Operator::describe.
+     */
+    using OperatorFactory = std::function<Operand(std::vector<Operand>& operands,
+        const std::vector<double>& attributes)>;
+
+    /**
+     * \brief Register an operator kind so that saved models containing it can be loaded.
+     * \details All the built-in operators are registered already. Custom operators should be described with
+     * \c Operator::describe and registered before loading models containing them.
+     * \param kind Kind of the operator.
+     * \param arity Amount of operands of the operator.
+     * \param factory The function rebuilding the operator.
+     */
+    void register_operator(const std::string& kind, size_t arity, OperatorFactory factory);
+
+    /**
+     * \brief Rebuild an operator of a registered kind.
+     * \param kind Kind of the operator.
+     * \param operands The operands, should be as many as the arity of the operator.
+     * \param attributes The attributes of the operator.
+     * \return The rebuilt operator.
+     */
+    Operand build_operator(const std::string& kind, std::vector<Operand>& operands,
+        const std::vector<double>& attributes);
+}
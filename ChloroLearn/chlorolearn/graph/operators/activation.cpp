@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cmath>
 
 #include "activation.h"
 
@@ -14,6 +15,7 @@ namespace chloro::operators
                 return OutParams{ gradient * param.apply([](const double v) { return v > 0 ? 1 : 0; }) };
             },
             operand.shape());
+        op.describe("relu");
         return Operand::join(std::move(op), { std::move(operand) });
     }
 
@@ -28,6 +30,7 @@ namespace chloro::operators
                 return OutParams{ gradient * param.apply([](const double v) { return v > 0 ? 1 : 0.01; }) };
             },
             operand.shape());
+        op.describe("leaky_relu");
         return Operand::join(std::move(op), { std::move(operand) });
     }
 
@@ -47,6 +50,7 @@ namespace chloro::operators
                         { return v * (1 - v); })
                 };
             }, operand.shape());
+        op.describe("sigmoid");
         return Operand::join(std::move(op), { std::move(operand) });
     }
 
@@ -57,7 +61,7 @@ namespace chloro::operators
             {
                 InParam param = params[0];
                 const double max = param.accumulate(param[0], [](const double x, const double y) { return x > y ? x : y; });
-                Array aug_exp = (param - max).apply(std::exp<double, double>);
+                Array aug_exp = (param - max).apply([](const double v) { return std::exp(v); });
                 const double sum = aug_exp.accumulate(0);
                 return aug_exp /= sum;
             },
@@ -75,6 +79,7 @@ namespace chloro::operators
                     }
                 return OutParams{ result };
             }, operand.shape());
+        op.describe("softmax");
         return Operand::join(std::move(op), { std::move(operand) });
     }
 }
@@ -6,6 +6,26 @@
 
 namespace chloro
 {
+    namespace
+    {
+        using detail::AxisSplit;
+        using detail::split_at_axis;
+        using detail::reduced_shape;
+
+        // Repeat the reduced gradient along the reduced axis
+        Array<double> expand_along_axis(const Array<double>& gradient, const ArrayShape& shape,
+            const AxisSplit split, const double scale = 1.0)
+        {
+            const auto [outer, length, inner] = split;
+            Array result = Array<double>::zeros(shape);
+            for (size_t i = 0; i < outer; i++)
+                for (size_t j = 0; j < length; j++)
+                    for (size_t k = 0; k < inner; k++)
+                        result[(i * length + j) * inner + k] = scale * gradient[i * inner + k];
+            return result;
+        }
+    }
+
     Operand operator+(Operand left, Operand right) { return operators::add(std::move(left), std::move(right)); }
     Operand operator-(Operand left, Operand right) { return operators::subtract(std::move(left), std::move(right)); }
     Operand operator*(Operand left, Operand right) { return operators::multiply(std::move(left), std::move(right)); }
@@ -17,6 +37,7 @@ namespace chloro
         {
             Operator op([](InParams params) { return params[0]; },
                 [](const BackwardParams params) { return OutParams{ params.gradient }; }, operand.shape());
+            op.describe("identity");
             return Operand::join(std::move(op), { std::move(operand) });
         }
 
@@ -24,6 +45,7 @@ namespace chloro
         {
             Operator op([](InParams params) { return params[0] + params[1]; },
                 [](const BackwardParams params) { return OutParams{ params.gradient, params.gradient }; }, left.shape());
+            op.describe("add");
             return Operand::join(std::move(op), { std::move(left), std::move(right) });
         }
 
@@ -31,6 +53,7 @@ namespace chloro
         {
             Operator op([](InParams params) { return params[0] - params[1]; },
                 [](const BackwardParams params) { return OutParams{ params.gradient, -params.gradient }; }, left.shape());
+            op.describe("subtract");
             return Operand::join(std::move(op), { std::move(left), std::move(right) });
         }
 
@@ -47,6 +70,7 @@ namespace chloro
                         childs[0] * gradient
                     };
                 }, left.shape());
+            op.describe("multiply");
             return Operand::join(std::move(op), { std::move(left), std::move(right) });
         }
 
@@ -64,6 +88,7 @@ namespace chloro
                         -left / right / right * gradient
                     };
                 }, left.shape());
+            op.describe("divide");
             return Operand::join(std::move(op), { std::move(left), std::move(right) });
         }
 
@@ -106,6 +131,7 @@ namespace chloro
                                 right_grad[i * right_col + j] += first[k * left_col + i] * gradient[k * right_col + j];
                     return OutParams{ left_grad, right_grad };
                 }, shape);
+            op.describe("matrix_multiply");
             return Operand::join(std::move(op), { std::move(left), std::move(right) });
         }
 
@@ -116,8 +142,9 @@ namespace chloro
             const ArrayShape& first_shape = scalar.shape();
             if (first_shape.size() != 1 || first_shape[0] != 1)
                 throw MismatchedSizesException("Repeated value isn't a scalar");
-            Operator op([&](InParams params) { return Array<double>::repeats(params[0].get()[0], shape); },
+            Operator op([=](InParams params) { return Array<double>::repeats(params[0].get()[0], shape); },
                 [](const BackwardParams params) { return OutParams{ params.gradient.accumulate(0) }; }, shape);
+            op.describe("repeat", { shape.begin(), shape.end() });
             return Operand::join(std::move(op), { std::move(scalar) });
         }
 
@@ -139,15 +166,87 @@ namespace chloro
                     result.force_reshape(params.childs[0].get().shape());
                     return OutParams{ result };
                 }, new_shape);
+            op.describe("reshape", { new_shape.begin(), new_shape.end() });
             return Operand::join(std::move(op), { std::move(input) });
         }
 
         Operand sum(Operand operand)
         {
             const ArrayShape& shape = operand.shape();
-            Operator op([](InParams params) { return params[0].get().accumulate(0); },
+            Operator op([](InParams params) { return Array{ params[0].get().sum() }; },
                 [=](const BackwardParams params)
                 { return OutParams{ Array<double>::repeats(params.gradient[0], shape) }; }, { 1 });
+            op.describe("sum");
+            return Operand::join(std::move(op), { std::move(operand) });
+        }
+
+        Operand sum(Operand operand, const size_t axis)
+        {
+            const ArrayShape& shape = operand.shape();
+            const AxisSplit split = split_at_axis(shape, axis);
+            Operator op([=](InParams params) { return params[0].get().sum(axis); },
+                [=](const BackwardParams params)
+                { return OutParams{ expand_along_axis(params.gradient, shape, split) }; },
+                reduced_shape(shape, axis));
+            op.describe("sum", { double(axis) });
+            return Operand::join(std::move(op), { std::move(operand) });
+        }
+
+        Operand mean(Operand operand, const size_t axis)
+        {
+            const ArrayShape& shape = operand.shape();
+            const AxisSplit split = split_at_axis(shape, axis);
+            Operator op([=](InParams params) { return params[0].get().mean(axis); },
+                [=](const BackwardParams params)
+                { return OutParams{ expand_along_axis(params.gradient, shape, split, 1.0 / split.length) }; },
+                reduced_shape(shape, axis));
+            op.describe("mean", { double(axis) });
+            return Operand::join(std::move(op), { std::move(operand) });
+        }
+
+        Operand max(Operand operand, const size_t axis)
+        {
+            const ArrayShape& shape = operand.shape();
+            const auto [outer, length, inner] = split_at_axis(shape, axis);
+            const ArrayShape output_shape = reduced_shape(shape, axis);
+            Operator op([=](InParams params) { return params[0].get().max(axis); },
+                [=](ForwardParams params)
+                {
+                    const Array<double>& param = params.childs[0];
+                    StateParam state = params.state;
+                    const Array<size_t> indices = param.argmax(axis);
+                    Array result = Array<double>::zeros(output_shape);
+                    for (size_t i = 0; i < outer; i++)
+                        for (size_t k = 0; k < inner; k++)
+                        {
+                            const size_t result_index = i * inner + k;
+                            const size_t input_index = (i * length + indices[result_index]) * inner + k;
+                            result[result_index] = param[input_index];
+                            state[result_index] = double(input_index);
+                        }
+                    return result;
+                },
+                [=](const BackwardParams params)
+                {
+                    const Array<double>& gradient = params.gradient;
+                    StateParam state = params.state;
+                    Array result = Array<double>::zeros(shape);
+                    const size_t size = gradient.size();
+                    for (size_t i = 0; i < size; i++) result[size_t(state[i])] = gradient[i];
+                    return OutParams{ result };
+                }, output_shape);
+            op.describe("max", { double(axis) });
+            return Operand::join(std::move(op), { std::move(operand) });
+        }
+
+        Operand argmax(Operand operand, const size_t axis)
+        {
+            const ArrayShape& shape = operand.shape();
+            split_at_axis(shape, axis);
+            Operator op([=](InParams params) { return Array<double>(params[0].get().argmax(axis)); },
+                [=](const BackwardParams) { return OutParams{ Array<double>::zeros(shape) }; },
+                reduced_shape(shape, axis));
+            op.describe("argmax", { double(axis) });
             return Operand::join(std::move(op), { std::move(operand) });
         }
 
@@ -165,6 +264,7 @@ namespace chloro
                             [=](const double v) { return std::pow(v, exponent - 1); })
                     };
                 }, base.shape());
+            op.describe("power", { exponent });
             return Operand::join(std::move(op), { std::move(base) });
         }
 
@@ -182,6 +282,7 @@ namespace chloro
                             [=](const double v) { return std::pow(base, v); })
                     };
                 }, exponent.shape());
+            op.describe("exp", { base });
             return Operand::join(std::move(op), { std::move(exponent) });
         }
     }
@@ -85,6 +85,39 @@ namespace chloro
          * \return A scalar shaped operand with the sum.
          */
         Operand sum(Operand operand);
+        /**
+         * \brief Calculates the sum of the operand along an axis.
+         * \param operand The input operand.
+         * \param axis The axis to reduce.
+         * \return The result operand, whose shape is the same as that of the input except that the
+         * reduced axis is removed. Reducing a 1D operand results in a scalar shaped operand.
+         */
+        Operand sum(Operand operand, size_t axis);
+        /**
+         * \brief Calculates the arithmetic mean of the operand along an axis.
+         * \param operand The input operand.
+         * \param axis The axis to reduce.
+         * \return The result operand, shaped like the result of \c sum along the same axis.
+         */
+        Operand mean(Operand operand, size_t axis);
+        /**
+         * \brief Finds the maximum values of the operand along an axis.
+         * \details The gradient is only propagated to the maximum values.
+         * \param operand The input operand.
+         * \param axis The axis to reduce.
+         * \return The result operand, shaped like the result of \c sum along the same axis.
+         */
+        Operand max(Operand operand, size_t axis);
+        /**
+         * \brief Finds the indices of the maximum values of the operand along an axis.
+         * \details Usually used for getting the predicted categories of a batch of predictions.
+         * Notice that the back-propagation process will not proceed to this branch.
+         * \param operand The input operand.
+         * \param axis The axis to reduce.
+         * \return The result operand containing 0-based indices, shaped like the result of \c sum
+         * along the same axis.
+         */
+        Operand argmax(Operand operand, size_t axis);
 
         /**
          * \brief Raise the \a base to the power \a exponent, with a constant
@@ -23,6 +23,7 @@ namespace chloro::operators
                 result[category] = -grad / param[category];
                 return OutParams{ result, {0} };
             }, { 1 });
+        op.describe("categorical_cross_entropy");
         return Operand::join(std::move(op), { std::move(predicted), std::move(target) });
     }
 }
@@ -1,4 +1,3 @@
-#include <numeric>
 #include <random>
 
 #include "basic_operators.h"
@@ -12,7 +11,7 @@ namespace chloro::operators
     Operand flatten(Operand input)
     {
         const ArrayShape& shape = input.shape();
-        const size_t size = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies());
+        const size_t size = shape.element_count();
         return reshape(std::move(input), { int(size),1 });
     }
 
@@ -97,6 +96,7 @@ namespace chloro::operators
                         }
                 return OutParams{ input_grad, filter_grad };
             }, output_shape);
+        op.describe("convolution_2d_with_padding", { double(stride_row), double(stride_column) });
         return Operand::join(std::move(op), { std::move(input), std::move(filters) });
     }
 
@@ -187,6 +187,8 @@ namespace chloro::operators
                 for (size_t i = 0; i < output_size; i++) result[size_t(state[i])] = gradient[i];
                 return OutParams{ result };
             }, output_shape);
+        op.describe("max_pool_2d",
+            { double(pool_row), double(pool_column), double(stride_row), double(stride_column) });
         return Operand::join(std::move(op), { std::move(input) });
     }
 
@@ -211,6 +213,7 @@ namespace chloro::operators
             },
             [=](const BackwardParams params) { return OutParams{ params.state * params.gradient }; },
                 input.shape());
+        op.describe("dropout", { dropout_rate });
         return Operand::join(std::move(op), { std::move(input) });
     }
 }
@@ -1,44 +1,208 @@
+#include <cmath>
+
 #include "optimizer.h"
 
 namespace chloro::optimizers
 {
-    Optimizer sgd(const double rate) { return [=](const Array<double>& gradient) { return rate * gradient; }; }
+    namespace
+    {
+        // Rough amount of floating point operations per element of the optimizer kernels
+        constexpr size_t kernel_cost = 8;
 
-    Optimizer adam(const double alpha, const double beta_1, const double beta_2, const double epsilon)
+        void check_sizes(const Array<double>& value, const Array<double>& gradient)
+        {
+            if (value.size() != gradient.size())
+                throw MismatchedSizesException("Sizes of the variable and the gradient don't match");
+        }
+
+        // Lazily (re)allocate an optimizer state array to match the variable
+        void prepare_state(Array<double>& state, const Array<double>& value)
+        {
+            if (state.size() != value.size()) state = Array<double>::zeros(value.shape());
+        }
+    }
+
+    double squared_norm(const Array<double>& array)
+    {
+        const size_t size = array.size();
+        const size_t chunks = std::min(thread_count(), std::max(size / parallel_grain, size_t(1)));
+        std::vector<double> partial(chunks);
+        const size_t chunk_size = (size + chunks - 1) / chunks;
+        const double* const values = array.data().data();
+        parallel_for(chunks, chunk_size, [&](const size_t begin, const size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    double sum[4]{};
+                    const size_t last = std::min((i + 1) * chunk_size, size);
+                    size_t j = i * chunk_size;
+                    for (; j + 4 <= last; j += 4)
+                        for (size_t k = 0; k < 4; k++)
+                            sum[k] += values[j + k] * values[j + k];
+                    for (; j < last; j++) sum[0] += values[j] * values[j];
+                    partial[i] = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+                }
+            });
+        return std::accumulate(partial.begin(), partial.end(), 0.0);
+    }
+
+    Optimizer sgd(const double rate)
+    {
+        return [=](Array<double>& value, Array<double>& gradient)
+        {
+            check_sizes(value, gradient);
+            double* const values = &value[0];
+            const double* const gradients = &gradient[0];
+            parallel_for(value.size(), kernel_cost, [=](const size_t begin, const size_t end)
+                { for (size_t i = begin; i < end; i++) values[i] -= rate * gradients[i]; });
+        };
+    }
+
+    Optimizer momentum(const double rate, const double momentum)
+    {
+        class Functor
+        {
+        private:
+            const double rate_;
+            const double momentum_;
+            Array<double> velocity_;
+        public:
+            Functor(const double rate, const double momentum) :rate_(rate), momentum_(momentum) {}
+            void operator()(Array<double>& value, Array<double>& gradient)
+            {
+                check_sizes(value, gradient);
+                prepare_state(velocity_, value);
+                double* const values = &value[0];
+                const double* const gradients = &gradient[0];
+                double* const velocity = &velocity_[0];
+                parallel_for(value.size(), kernel_cost, [=, rate = rate_, momentum = momentum_]
+                    (const size_t begin, const size_t end)
+                    {
+                        for (size_t i = begin; i < end; i++)
+                        {
+                            velocity[i] = momentum * velocity[i] + gradients[i];
+                            values[i] -= rate * velocity[i];
+                        }
+                    });
+            }
+        };
+        return Functor(rate, momentum);
+    }
+
+    Optimizer nesterov(const double rate, const double momentum)
     {
         class Functor
         {
+        private:
+            const double rate_;
+            const double momentum_;
+            Array<double> velocity_;
+        public:
+            Functor(const double rate, const double momentum) :rate_(rate), momentum_(momentum) {}
+            void operator()(Array<double>& value, Array<double>& gradient)
+            {
+                check_sizes(value, gradient);
+                prepare_state(velocity_, value);
+                double* const values = &value[0];
+                const double* const gradients = &gradient[0];
+                double* const velocity = &velocity_[0];
+                parallel_for(value.size(), kernel_cost, [=, rate = rate_, momentum = momentum_]
+                    (const size_t begin, const size_t end)
+                    {
+                        for (size_t i = begin; i < end; i++)
+                        {
+                            velocity[i] = momentum * velocity[i] + gradients[i];
+                            values[i] -= rate * (gradients[i] + momentum * velocity[i]);
+                        }
+                    });
+            }
+        };
+        return Functor(rate, momentum);
+    }
+
+    namespace
+    {
+        class AdamFunctor
+        {
         private:
             const double alpha_;
             const double beta_1_;
             const double beta_2_;
             const double epsilon_;
+            const double weight_decay_;
             double beta_1_t_ = 1.0;
             double beta_2_t_ = 1.0;
             Array<double> first_;
             Array<double> second_;
-            bool first_evaluation_ = true;
         public:
-            Functor(const double alpha, const double beta_1, const double beta_2, const double epsilon)
-                :alpha_(alpha), beta_1_(beta_1), beta_2_(beta_2), epsilon_(epsilon) {}
-            Array<double> operator() (const Array<double>& gradient)
+            AdamFunctor(const double alpha, const double beta_1, const double beta_2, const double epsilon,
+                const double weight_decay) :
+                alpha_(alpha), beta_1_(beta_1), beta_2_(beta_2), epsilon_(epsilon), weight_decay_(weight_decay) {}
+            void operator()(Array<double>& value, Array<double>& gradient)
             {
-                if (first_evaluation_)
-                {
-                    const ArrayShape& shape = gradient.shape();
-                    first_ = Array<double>::zeros(shape);
-                    second_ = Array<double>::zeros(shape);
-                    first_evaluation_ = false;
-                }
+                check_sizes(value, gradient);
+                prepare_state(first_, value);
+                prepare_state(second_, value);
                 beta_1_t_ *= beta_1_;
                 beta_2_t_ *= beta_2_;
-                first_ = beta_1_ * first_ + (1 - beta_1_) * gradient;
-                second_ = beta_2_ * second_ + (1 - beta_2_) * gradient * gradient;
-                first_ /= 1 - beta_1_t_;
-                second_ /= 1 - beta_2_t_;
-                return alpha_ * first_ / (second_.apply([](const double value) { return std::sqrt(value); }) + epsilon_);
+                // Bias corrections are folded into the step size and the second moment scale
+                const double step = alpha_ / (1 - beta_1_t_);
+                const double second_scale = 1 / (1 - beta_2_t_);
+                const double decay = alpha_ * weight_decay_;
+                double* const values = &value[0];
+                const double* const gradients = &gradient[0];
+                double* const first = &first_[0];
+                double* const second = &second_[0];
+                parallel_for(value.size(), kernel_cost, [=, beta_1 = beta_1_, beta_2 = beta_2_, epsilon = epsilon_]
+                    (const size_t begin, const size_t end)
+                    {
+                        for (size_t i = begin; i < end; i++)
+                        {
+                            const double grad = gradients[i];
+                            first[i] = beta_1 * first[i] + (1 - beta_1) * grad;
+                            second[i] = beta_2 * second[i] + (1 - beta_2) * grad * grad;
+                            values[i] -= step * first[i] / (std::sqrt(second[i] * second_scale) + epsilon)
+                                + decay * values[i];
+                        }
+                    });
             }
         };
-        return Functor(alpha, beta_1, beta_2, epsilon);
+    }
+
+    Optimizer adam(const double alpha, const double beta_1, const double beta_2, const double epsilon)
+    {
+        return AdamFunctor(alpha, beta_1, beta_2, epsilon, 0.0);
+    }
+
+    Optimizer adamw(const double alpha, const double beta_1, const double beta_2, const double epsilon,
+        const double weight_decay)
+    {
+        return AdamFunctor(alpha, beta_1, beta_2, epsilon, weight_decay);
+    }
+
+    Optimizer clip_by_value(Optimizer optimizer, const double bound)
+    {
+        if (bound <= 0) throw IllegalArgumentException("The clipping bound should be positive");
+        return [optimizer = std::move(optimizer), bound](Array<double>& value, Array<double>& gradient)
+        {
+            double* const gradients = &gradient[0];
+            parallel_for(gradient.size(), 2, [=](const size_t begin, const size_t end)
+                {
+                    for (size_t i = begin; i < end; i++)
+                        gradients[i] = gradients[i] > bound ? bound : gradients[i] < -bound ? -bound : gradients[i];
+                });
+            optimizer(value, gradient);
+        };
+    }
+
+    Optimizer clip_by_global_norm(Optimizer optimizer, const double max_norm)
+    {
+        if (max_norm <= 0) throw IllegalArgumentException("The maximum norm should be positive");
+        return [optimizer = std::move(optimizer), max_norm](Array<double>& value, Array<double>& gradient)
+        {
+            const double norm = std::sqrt(squared_norm(gradient));
+            if (norm > max_norm) gradient *= max_norm / norm;
+            optimizer(value, gradient);
+        };
     }
 }
@@ -6,7 +6,13 @@
 
 namespace chloro
 {
-    using Optimizer = std::function<Array<double>(const Array<double>&)>;
+    /**
+     * \brief An optimizer updates a variable in place given the gradient of the target w.r.t. it.
+     * \details The first parameter is the value of the variable, the second one is the gradient. Optimizers
+     * may hold internal states (like moment estimates), which are updated together with the value in the
+     * same pass, and may overwrite the gradient, since it is cleared before the next step anyway.
+     */
+    using Optimizer = std::function<void(Array<double>&, Array<double>&)>;
     using OptimizerGenerator = std::function<Optimizer()>;
 
     /** \brief Provide some common optimizers like SGD and Adam. */
@@ -19,6 +25,22 @@ namespace chloro
          */
         Optimizer sgd(double rate = 0.001);
 
+        /**
+         * \brief Stochastic gradient descent optimizer with momentum.
+         * \param rate Learning rate.
+         * \param momentum Decay rate of the accumulated velocity.
+         * \return The result optimizer.
+         */
+        Optimizer momentum(double rate = 0.001, double momentum = 0.9);
+
+        /**
+         * \brief Stochastic gradient descent optimizer with Nesterov momentum.
+         * \param rate Learning rate.
+         * \param momentum Decay rate of the accumulated velocity.
+         * \return The result optimizer.
+         */
+        Optimizer nesterov(double rate = 0.001, double momentum = 0.9);
+
         /**
          * \brief Adam (Adaptive moment estimation) optimizer.
          * \param alpha Step size, or learning rate.
@@ -28,5 +50,43 @@ namespace chloro
          * \return The result optimizer.
          */
         Optimizer adam(double alpha = 0.001, double beta_1 = 0.9, double beta_2 = 0.999, double epsilon = 1e-8);
+
+        /**
+         * \brief AdamW optimizer, Adam with decoupled weight decay.
+         * \param alpha Step size, or learning rate.
+         * \param beta_1 Exponential decay rate for first moment estimates.
+         * \param beta_2 Exponential decay rate for second moment estimates.
+         * \param epsilon A small positive value to avoid division by zero.
+         * \param weight_decay Decay rate of the variable values, applied independently of the gradient.
+         * \return The result optimizer.
+         */
+        Optimizer adamw(double alpha = 0.001, double beta_1 = 0.9, double beta_2 = 0.999, double epsilon = 1e-8,
+            double weight_decay = 0.01);
+
+        /**
+         * \brief Clip every component of the gradients into [-\a bound, \a bound] before passing them
+         * to another optimizer.
+         * \param optimizer The wrapped optimizer.
+         * \param bound Maximum absolute value of the gradient components.
+         * \return The result optimizer.
+         */
+        Optimizer clip_by_value(Optimizer optimizer, double bound = 5.0);
+
+        /**
+         * \brief Scale the gradients down if their global L2 norm exceeds a threshold before passing them
+         * to another optimizer.
+         * \details Since the graph applies the optimizer once per step to the gradients of all the variables
+         * at once, the norm is computed over all the parameters of the graph.
+         * \param optimizer The wrapped optimizer.
+         * \param max_norm Maximum L2 norm of the gradients.
+         * \return The result optimizer.
+         */
+        Optimizer clip_by_global_norm(Optimizer optimizer, double max_norm = 1.0);
+
+        /**
+         * \brief Get the squared L2 norm of an array, like the gradients of all the parameters.
+         * \details The sum is computed in parallel for large arrays.
+         */
+        double squared_norm(const Array<double>& array);
     }
 }
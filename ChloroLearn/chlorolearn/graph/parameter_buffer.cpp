@@ -0,0 +1,49 @@
+#include "parameter_buffer.h"
+
+namespace chloro
+{
+    void ParameterBuffer::AlignedDeleter::operator()(double* pointer) const
+    {
+        MemoryTracker::released(memory_tag, bytes);
+        allocator->deallocate(pointer, bytes);
+    }
+
+    ParameterBuffer::ParameterBuffer(const std::vector<ArrayShape>& shapes) :shapes_(shapes)
+    {
+        constexpr size_t stride = alignment / sizeof(double);
+        for (const ArrayShape& shape : shapes)
+        {
+            offsets_.push_back(size_);
+            const size_t size = shape.element_count();
+            size_ += (size + stride - 1) / stride * stride;
+        }
+        if (size_ == 0) return;
+        // Values and gradients share one allocation
+        const size_t bytes = 2 * size_ * sizeof(double);
+        ArrayAllocator& allocator = ArrayAllocator::current();
+        double* pointer = static_cast<double*>(allocator.allocate(bytes));
+        storage_ = std::unique_ptr<double[], AlignedDeleter>(pointer,
+            { bytes, MemoryTracker::allocated(bytes), &allocator });
+        std::fill(pointer, pointer + 2 * size_, 0.0);
+        values_ = Array<double>::view(pointer, { size_ });
+        gradients_ = Array<double>::view(pointer + size_, { size_ });
+    }
+
+    Array<double> ParameterBuffer::value_view(const size_t index)
+    {
+        if (index >= shapes_.size()) throw ArgumentOutOfRangeException("Parameter index out of range");
+        return Array<double>::view(storage_.get() + offsets_[index], shapes_[index]);
+    }
+
+    Array<double> ParameterBuffer::gradient_view(const size_t index)
+    {
+        if (index >= shapes_.size()) throw ArgumentOutOfRangeException("Parameter index out of range");
+        return Array<double>::view(storage_.get() + size_ + offsets_[index], shapes_[index]);
+    }
+
+    const double* ParameterBuffer::value_data(const size_t index) const
+    {
+        if (index >= shapes_.size()) throw ArgumentOutOfRangeException("Parameter index out of range");
+        return storage_.get() + offsets_[index];
+    }
+}
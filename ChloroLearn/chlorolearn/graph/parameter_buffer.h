@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "../basic/array.h"
+
+namespace chloro
+{
+    /**
+     * \brief Contiguous storage for the values and gradients of all the variables in a graph.
+     * \details Values of all the parameters are laid out in a single aligned block of memory, and so are
+     * their gradients, each parameter starting at a cache line boundary. The variables then view their slices
+     * of the buffers, so that clearing the gradients or applying an optimizer to all the variables takes a
+     * single linear pass over the whole buffer. The gaps between the slices are kept zero.
+     * \details The block comes from the \c ArrayAllocator current when the buffer is constructed.
+     */
+    class ParameterBuffer final
+    {
+    private:
+        struct AlignedDeleter
+        {
+            size_t bytes;
+            uint32_t memory_tag;
+            ArrayAllocator* allocator;
+            void operator()(double* pointer) const;
+        };
+        std::unique_ptr<double[], AlignedDeleter> storage_;
+        std::vector<size_t> offsets_;
+        std::vector<ArrayShape> shapes_;
+        size_t size_ = 0;
+        Array<double> values_;
+        Array<double> gradients_;
+    public:
+        /** \brief Alignment of the buffers and the parameter slices in bytes. */
+        static constexpr size_t alignment = ArrayAllocator::alignment;
+        /** \brief Constructs an empty buffer. */
+        ParameterBuffer() = default;
+        /**
+         * \brief Allocate zero filled buffers for parameters of the given shapes.
+         * \param shapes Shapes of the parameters.
+         */
+        explicit ParameterBuffer(const std::vector<ArrayShape>& shapes);
+        /** \brief Get the amount of parameters in the buffer. */
+        size_t parameter_count() const { return shapes_.size(); }
+        /** \brief Get the total length of the buffers, including the alignment gaps. */
+        size_t size() const { return size_; }
+        /** \brief Get a view of the value slice of a parameter. */
+        Array<double> value_view(size_t index);
+        /** \brief Get a view of the gradient slice of a parameter. */
+        Array<double> gradient_view(size_t index);
+        /** \brief Get a pointer to the first value of a parameter. */
+        const double* value_data(size_t index) const;
+        /** \brief Get a view of the whole value buffer. */
+        Array<double>& values() { return values_; }
+        /** \brief Get a read only view of the whole value buffer. */
+        const Array<double>& values() const { return values_; }
+        /** \brief Get a view of the whole gradient buffer. */
+        Array<double>& gradients() { return gradients_; }
+        /** \brief Get a read only view of the whole gradient buffer. */
+        const Array<double>& gradients() const { return gradients_; }
+        /** \brief Set all the gradients to zero. */
+        void clear_gradients() { gradients_.clear(); }
+    };
+}
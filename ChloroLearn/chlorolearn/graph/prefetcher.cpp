@@ -0,0 +1,96 @@
+#include <random>
+#include <algorithm>
+
+#include "prefetcher.h"
+
+namespace chloro
+{
+    void InputPrefetcher::run()
+    {
+        try
+        {
+            const MemoryScope scope(MemoryCategory::inputs);
+            std::mt19937 generator{ std::random_device{}() };
+            const size_t epoch_size = source_.size();
+            std::vector<size_t> permutation(epoch_size);
+            while (true)
+            {
+                for (size_t i = 0; i < epoch_size; i++) permutation[i] = i;
+                std::shuffle(permutation.begin(), permutation.end(), generator);
+                for (const size_t index : permutation)
+                {
+                    size_t slot;
+                    {
+                        std::unique_lock lock(mutex_);
+                        free_condition_.wait(lock, [this] { return stopping_ || !free_.empty(); });
+                        if (stopping_) return;
+                        slot = free_.front();
+                        free_.pop();
+                    }
+                    std::vector<Array<double>>& staged = slots_[slot];
+                    const size_t field_count = inputs_.size();
+                    for (size_t i = 0; i < field_count; i++)
+                    {
+                        source_.fetch(index, i, staged[i]);
+                        inputs_[i].get().validate(staged[i]);
+                    }
+                    {
+                        std::lock_guard lock(mutex_);
+                        ready_.push(slot);
+                    }
+                    ready_condition_.notify_one();
+                }
+            }
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard lock(mutex_);
+                error_ = std::current_exception();
+            }
+            ready_condition_.notify_one();
+        }
+    }
+
+    InputPrefetcher::InputPrefetcher(const DataSource& source, std::vector<std::reference_wrapper<Input>> inputs,
+        const size_t depth) :
+        source_(source), inputs_(std::move(inputs)), slots_(depth, std::vector<Array<double>>(inputs_.size()))
+    {
+        if (depth == 0) throw IllegalArgumentException("Prefetch depth should be positive");
+        if (source_.size() == 0) throw IllegalArgumentException("The data source should not be empty");
+        if (source_.field_count() != inputs_.size())
+            throw MismatchedSizesException("Every field of the data source should feed an input node");
+        for (size_t i = 0; i < depth; i++) free_.push(i);
+        worker_ = std::thread([this] { run(); });
+    }
+
+    InputPrefetcher::~InputPrefetcher() noexcept
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        free_condition_.notify_one();
+        worker_.join();
+    }
+
+    void InputPrefetcher::load_next()
+    {
+        size_t slot;
+        {
+            std::unique_lock lock(mutex_);
+            ready_condition_.wait(lock, [this] { return error_ || !ready_.empty(); });
+            if (ready_.empty()) std::rethrow_exception(error_);
+            slot = ready_.front();
+            ready_.pop();
+        }
+        std::vector<Array<double>>& staged = slots_[slot];
+        const size_t field_count = inputs_.size();
+        for (size_t i = 0; i < field_count; i++) inputs_[i].get().exchange(staged[i]);
+        {
+            std::lock_guard lock(mutex_);
+            free_.push(slot);
+        }
+        free_condition_.notify_one();
+    }
+}
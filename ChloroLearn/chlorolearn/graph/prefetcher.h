@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "nodes/input.h"
+#include "../utility/data_source.h"
+
+namespace chloro
+{
+    /**
+     * \brief A background pipeline stage that prepares the inputs of the next training samples.
+     * \details A worker thread walks through shuffled epochs of a data source, validates every sample and
+     * fetches it into one of a fixed set of reusable staging slots, while the training thread computes the
+     * current step. The training thread then swaps the staged arrays into the \c Input nodes without copying,
+     * and the slots, now holding the previous inputs, are handed back to the worker for refilling.
+     * \remark Used by \c Graph::optimize, users should not need to use this class directly.
+     */
+    class InputPrefetcher final
+    {
+    private:
+        const DataSource& source_;
+        std::vector<std::reference_wrapper<Input>> inputs_;
+        std::vector<std::vector<Array<double>>> slots_;
+        std::queue<size_t> free_;
+        std::queue<size_t> ready_;
+        std::mutex mutex_;
+        std::condition_variable free_condition_;
+        std::condition_variable ready_condition_;
+        bool stopping_ = false;
+        std::exception_ptr error_;
+        std::thread worker_;
+        void run();
+    public:
+        /**
+         * \brief Constructs a prefetcher and starts the worker thread.
+         * \param source The data source, which should outlive the prefetcher.
+         * \param inputs The input node contents fed by the fields of the data source.
+         * \param depth Amount of samples that can be staged ahead of the training thread, should be positive.
+         */
+        InputPrefetcher(const DataSource& source, std::vector<std::reference_wrapper<Input>> inputs, size_t depth);
+        InputPrefetcher(const InputPrefetcher&) = delete;
+        InputPrefetcher& operator=(const InputPrefetcher&) = delete;
+        /** \brief Stops and joins the worker thread. */
+        ~InputPrefetcher() noexcept;
+        /**
+         * \brief Wait for the next staged sample and swap it into the input nodes.
+         * \remark Rethrows any exception thrown on the worker thread, like input shape mismatches.
+         */
+        void load_next();
+    };
+}
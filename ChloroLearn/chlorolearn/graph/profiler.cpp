@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "profiler.h"
+
+namespace chloro
+{
+    namespace
+    {
+        const char* const phase_names[profile_phase_count] = { "forward", "backward", "optimizer", "input" };
+        const char* const counter_names[perf_counter_count] =
+            { "cycles", "instructions", "cache_misses", "branch_misses" };
+
+        double size_of(const ArrayShape& shape)
+        {
+            return double(shape.element_count());
+        }
+
+        void write_json_string(std::ostream& stream, const std::string& value)
+        {
+            stream << '"';
+            for (const char c : value)
+            {
+                if (c == '"' || c == '\\') stream << '\\' << c;
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    stream << escaped;
+                }
+                else stream << c;
+            }
+            stream << '"';
+        }
+    }
+
+    std::array<ProfileCost, 2> estimate_cost(const OperatorDescriptor& descriptor,
+        const std::vector<ArrayShape>& childs, const ArrayShape& shape)
+    {
+        const std::string& kind = descriptor.kind;
+        const double size = size_of(shape);
+        double child_size = 0.0;
+        for (const ArrayShape& child : childs) child_size += size_of(child);
+        // By default every element of the result takes one operation, and the backward phase reads the
+        // gradient, the childs and the result, then writes the gradients of the childs
+        ProfileCost forward{ size, (child_size + size) * sizeof(double) };
+        ProfileCost backward{ 2 * size, (2 * child_size + 2 * size) * sizeof(double) };
+        if (kind == "matrix_multiply")
+        {
+            const double multiply_adds = size * double(childs[0][1]);
+            forward.flops = 2 * multiply_adds;
+            backward.flops = 4 * multiply_adds;
+        }
+        else if (kind == "convolution_2d_with_padding")
+        {
+            const ArrayShape& filter = childs[1];
+            const double multiply_adds = size * double(filter[1] * filter[2] * filter[3]);
+            forward.flops = 2 * multiply_adds;
+            backward.flops = 4 * multiply_adds;
+        }
+        else if (kind == "max_pool_2d" || kind == "sum" || kind == "mean" || kind == "max" || kind == "argmax")
+        {
+            forward.flops = child_size;
+            backward.flops = child_size;
+        }
+        else if (kind == "softmax")
+        {
+            forward.flops = 4 * size;
+            backward.flops = 3 * size * size; // The Jacobian is computed in full
+        }
+        else if (kind == "reshape" || kind == "identity" || kind == "repeat")
+        {
+            forward.flops = 0.0;
+            backward.flops = 0.0;
+        }
+        return { forward, backward };
+    }
+
+    Profiler::Profiler(const size_t trace_capacity) :trace_capacity_(trace_capacity), origin_(Clock::now()) {}
+
+    size_t Profiler::add_entry(std::string name, std::string kind,
+        const std::array<ProfileCost, profile_phase_count>& costs)
+    {
+        entries_.push_back({ std::move(name), std::move(kind), costs, {} });
+        return entries_.size() - 1;
+    }
+
+    bool Profiler::enable_counters(const bool enabled)
+    {
+        counters_.reset();
+        if (!enabled) return false;
+        auto counters = std::make_unique<PerfCounters>();
+        if (counters->available()) counters_ = std::move(counters);
+        return counters_ != nullptr;
+    }
+
+    void Profiler::clear()
+    {
+        for (ProfileEntry& entry : entries_) entry.stats = {};
+        events_.clear();
+        origin_ = Clock::now();
+    }
+
+    void Profiler::write_report(std::ostream& stream) const
+    {
+        struct Row
+        {
+            const ProfileEntry* entry;
+            size_t phase;
+        };
+        std::vector<Row> rows;
+        double total = 0.0;
+        for (const ProfileEntry& entry : entries_)
+            for (size_t i = 0; i < profile_phase_count; i++)
+                if (entry.stats[i].calls > 0)
+                {
+                    rows.push_back({ &entry, i });
+                    total += entry.stats[i].seconds;
+                }
+        std::stable_sort(rows.begin(), rows.end(), [](const Row& left, const Row& right)
+            { return left.entry->stats[left.phase].seconds > right.entry->stats[right.phase].seconds; });
+        char line[384];
+        // Ratios of counters which are unavailable are shown as "-"
+        const auto write_ratio = [](char* text, const bool available, const double numerator, const double denominator,
+            const double scale)
+        {
+            if (available && denominator > 0) std::snprintf(text, 16, "%9.3f", numerator / denominator * scale);
+            else std::snprintf(text, 16, "%9s", "-");
+        };
+        std::snprintf(line, sizeof(line), "%-32s %-28s %-9s %10s %12s %10s %7s %9s %9s",
+            "name", "kind", "phase", "calls", "total ms", "avg us", "%", "GFLOP/s", "GB/s");
+        stream << line;
+        if (counters_)
+        {
+            std::snprintf(line, sizeof(line), " %12s %9s %9s %9s %9s", "Mcycles", "IPC", "FLOP/cyc", "LLC MPKI",
+                "br MPKI");
+            stream << line;
+        }
+        stream << '\n';
+        for (const Row& row : rows)
+        {
+            const ProfileStats& stats = row.entry->stats[row.phase];
+            const double seconds = stats.seconds > 0 ? stats.seconds : 1e-12;
+            std::snprintf(line, sizeof(line), "%-32.32s %-28.28s %-9s %10zu %12.3f %10.3f %7.2f %9.3f %9.3f",
+                row.entry->name.c_str(), row.entry->kind.c_str(), phase_names[row.phase], stats.calls,
+                stats.seconds * 1e3, stats.seconds * 1e6 / double(stats.calls),
+                total > 0 ? stats.seconds / total * 100 : 0.0, stats.flops / seconds / 1e9, stats.bytes / seconds / 1e9);
+            stream << line;
+            if (counters_)
+            {
+                const double cycles = double(stats.counters[size_t(PerfCounter::cycles)]);
+                const double instructions = double(stats.counters[size_t(PerfCounter::instructions)]);
+                char ratios[4][16];
+                write_ratio(ratios[0], counters_->available(PerfCounter::instructions), instructions, cycles, 1.0);
+                write_ratio(ratios[1], true, stats.flops, cycles, 1.0);
+                write_ratio(ratios[2], counters_->available(PerfCounter::cache_misses),
+                    double(stats.counters[size_t(PerfCounter::cache_misses)]), instructions, 1e3);
+                write_ratio(ratios[3], counters_->available(PerfCounter::branch_misses),
+                    double(stats.counters[size_t(PerfCounter::branch_misses)]), instructions, 1e3);
+                std::snprintf(line, sizeof(line), " %12.3f %s %s %s %s", cycles / 1e6, ratios[0], ratios[1],
+                    ratios[2], ratios[3]);
+                stream << line;
+            }
+            stream << '\n';
+        }
+        std::snprintf(line, sizeof(line), "total %.3f ms\n", total * 1e3);
+        stream << line;
+    }
+
+    std::string Profiler::report() const
+    {
+        std::ostringstream stream;
+        write_report(stream);
+        return stream.str();
+    }
+
+    void Profiler::write_trace(const std::string& path) const
+    {
+        std::ofstream stream(path);
+        if (!stream) throw IOException("Failed to open the trace file");
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        char numbers[64];
+        for (size_t i = 0; i < events_.size(); i++)
+        {
+            const Event& event = events_[i];
+            const ProfileEntry& entry = entries_[event.entry];
+            // Chrome traces are in microseconds
+            const double start = std::chrono::duration<double, std::micro>(event.start - origin_).count();
+            const double duration = std::chrono::duration<double, std::micro>(event.end - event.start).count();
+            stream << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+            write_json_string(stream, entry.name);
+            stream << ",\"cat\":\"" << phase_names[size_t(event.phase)] << "\",\"ph\":\"X\",";
+            std::snprintf(numbers, sizeof(numbers), "\"ts\":%.3f,\"dur\":%.3f", start, duration);
+            stream << numbers << ",\"pid\":0,\"tid\":0,\"args\":{\"kind\":";
+            write_json_string(stream, entry.kind);
+            if (counters_)
+                for (size_t j = 0; j < perf_counter_count; j++)
+                    if (counters_->available(PerfCounter(j)))
+                        stream << ",\"" << counter_names[j] << "\":" << event.counters[j];
+            stream << "}}";
+        }
+        stream << "\n]}\n";
+        if (!stream) throw IOException("Failed to write the trace file");
+    }
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "nodes/operator.h"
+#include "../utility/perf_counters.h"
+
+namespace chloro
+{
+    /** \brief Phases of training and inference which are profiled. */
+    enum class ProfilePhase : size_t
+    {
+        forward, /**< \brief Evaluation or forward propagation of an operator. */
+        backward, /**< \brief Back propagation of an operator. */
+        optimizer, /**< \brief Applying the optimizer to the parameters. */
+        input /**< \brief Loading the next sample into the input nodes. */
+    };
+
+    /** \brief Amount of the profiled phases. */
+    constexpr size_t profile_phase_count = 4;
+
+    /** \brief Estimated work of one call in a phase. */
+    struct ProfileCost final
+    {
+        double flops = 0.0; /**< \brief Floating point operations. */
+        double bytes = 0.0; /**< \brief Bytes read and written. */
+    };
+
+    /** \brief Aggregated statistics of a phase of a profiled entry. */
+    struct ProfileStats final
+    {
+        size_t calls = 0; /**< \brief Amount of calls. */
+        double seconds = 0.0; /**< \brief Total wall time. */
+        double flops = 0.0; /**< \brief Total estimated floating point operations. */
+        double bytes = 0.0; /**< \brief Total estimated bytes moved. */
+        PerfReading counters{}; /**< \brief Total counted hardware events, see \c Profiler::enable_counters. */
+    };
+
+    /** \brief A profiled operator node, or a profiled part of the training loop like the optimizer. */
+    struct ProfileEntry final
+    {
+        std::string name; /**< \brief Name of the node, or of the part of the training loop. */
+        std::string kind; /**< \brief Kind of the operator, see \c OperatorDescriptor. */
+        std::array<ProfileCost, profile_phase_count> costs; /**< \brief Estimated work per call of each phase. */
+        std::array<ProfileStats, profile_phase_count> stats; /**< \brief Statistics of each phase. */
+    };
+
+    /**
+     * \brief Estimate the work of evaluating and back propagating an operator from its kind and shapes.
+     * \details The estimates count multiply-adds as two operations and all the other arithmetic as one, and
+     * assume every operand, result and gradient is read or written once. They are rough, but good enough
+     * for telling compute bound operators from memory bound ones.
+     * \param descriptor Description of the operator.
+     * \param childs Shapes of the child nodes.
+     * \param shape Shape of the result.
+     * \return Estimated costs of the forward and the backward phase.
+     */
+    std::array<ProfileCost, 2> estimate_cost(const OperatorDescriptor& descriptor,
+        const std::vector<ArrayShape>& childs, const ArrayShape& shape);
+
+    /**
+     * \brief Collects per-node timings of a graph, see \c Graph::set_profiler.
+     * \details Every call of a profiled phase is timed and aggregated into the entries, together with the
+     * estimated work, and is also kept as a trace event if there's room left. The aggregated statistics can
+     * be printed as a table, and the events can be exported as a Chrome trace (chrome://tracing or Perfetto).
+     * \details Optionally, hardware events like cycles and cache misses are counted as well, which tells
+     * whether a kernel is compute bound or memory bound more directly than the estimated rates.
+     * \remark Profiling is single-threaded, like the training loop it's made for.
+     */
+    class Profiler final
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using TimePoint = Clock::time_point;
+        /** \brief The time and the counted hardware events at the start of a profiled call. */
+        struct Mark final
+        {
+            TimePoint time; /**< \brief Time of the start. */
+            PerfSamples counters{}; /**< \brief Counters at the start, zeros if they're not enabled. */
+        };
+    private:
+        struct Event
+        {
+            size_t entry;
+            ProfilePhase phase;
+            TimePoint start;
+            TimePoint end;
+            PerfReading counters;
+        };
+        std::vector<ProfileEntry> entries_;
+        std::vector<Event> events_;
+        size_t trace_capacity_;
+        TimePoint origin_;
+        std::unique_ptr<PerfCounters> counters_;
+    public:
+        /**
+         * \brief Construct a profiler.
+         * \param trace_capacity Maximum amount of trace events to keep, 0 for only aggregating statistics.
+         * Events after the first \a trace_capacity ones are aggregated but not traced.
+         */
+        explicit Profiler(size_t trace_capacity = size_t(1) << 20);
+        /**
+         * \brief Add an entry to profile.
+         * \param name Name of the entry shown in the report and the trace.
+         * \param kind Kind of the entry.
+         * \param costs Estimated work per call of each phase.
+         * \return Index of the entry.
+         */
+        size_t add_entry(std::string name, std::string kind, const std::array<ProfileCost, profile_phase_count>& costs = {});
+        /**
+         * \brief Count hardware events of the profiled calls, see \c PerfCounters.
+         * \details Reading the counters takes a few system calls per profiled call, so the timings of small
+         * operators get noticeably inflated. The counts only include the calling thread, not the worker threads
+         * of the parallel kernels.
+         * \param enabled Whether to count the events.
+         * \return Whether the counters are enabled, which is false if none of them is available, like in
+         * containers without the permission to use them. Profiling works as usual without them.
+         */
+        bool enable_counters(bool enabled = true);
+        /** \brief Check whether hardware events are counted. */
+        bool counters_enabled() const { return counters_ != nullptr; }
+        /** \brief Mark the start of a profiled call. */
+        Mark start() const
+        {
+            Mark mark;
+            if (counters_) mark.counters = counters_->sample();
+            mark.time = Clock::now();
+            return mark;
+        }
+        /** \brief Record a call of a phase of an entry, which started at \a start and ends now. */
+        void record(const size_t entry, const ProfilePhase phase, const Mark& start)
+        {
+            const TimePoint end = Clock::now();
+            PerfReading counters{};
+            // Subtracting scaled readings could wrap around, so the raw samples are subtracted then scaled
+            if (counters_) counters = PerfCounters::difference(start.counters, counters_->sample());
+            ProfileStats& stats = entries_[entry].stats[size_t(phase)];
+            const ProfileCost& cost = entries_[entry].costs[size_t(phase)];
+            stats.calls++;
+            stats.seconds += std::chrono::duration<double>(end - start.time).count();
+            stats.flops += cost.flops;
+            stats.bytes += cost.bytes;
+            for (size_t i = 0; i < perf_counter_count; i++) stats.counters[i] += counters[i];
+            if (events_.size() < trace_capacity_) events_.push_back({ entry, phase, start.time, end, counters });
+        }
+        /** \brief Get the profiled entries. */
+        const std::vector<ProfileEntry>& entries() const { return entries_; }
+        /** \brief Get the amount of recorded trace events. */
+        size_t event_count() const { return events_.size(); }
+        /** \brief Clear the statistics and the trace events, but keep the entries. */
+        void clear();
+        /**
+         * \brief Write a table of the statistics, sorted by the total time.
+         * \details Every phase of every entry which has been called is a row, with the amount of calls, the
+         * total and average time, the share of the total profiled time, and the achieved FLOP and byte rates.
+         * With counters enabled, the table also lists the cycles, the instructions per cycle, the FLOPs per
+         * cycle, and the cache misses and branch misses per thousand instructions.
+         */
+        void write_report(std::ostream& stream) const;
+        /** \brief Get the table written by \c write_report as a string. */
+        std::string report() const;
+        /**
+         * \brief Write the trace events as a Chrome trace-event JSON file, with the counted hardware events
+         * as arguments of the events if counters are enabled.
+         * \param path The full path or relative path to the JSON file.
+         */
+        void write_trace(const std::string& path) const;
+    };
+}
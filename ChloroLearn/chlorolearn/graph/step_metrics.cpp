@@ -0,0 +1,83 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+#include "step_metrics.h"
+#include "../basic/exceptions.h"
+
+namespace chloro::metrics_sinks
+{
+    namespace
+    {
+        // The counts come first, then the values. JSON has no literal for NaN or infinity, so they're
+        // written as null there
+        const char* const field_names[] = { "batch", "epoch", "samples", "optimizer_steps", "seconds",
+            "samples_per_second", "input_seconds", "forward_seconds", "backward_seconds", "optimizer_seconds",
+            "loss", "running_loss", "gradient_norm" };
+
+        std::string format_values(const StepMetrics& metrics, const char* separator, const bool named)
+        {
+            const size_t counts[] = { metrics.batch, metrics.epoch, metrics.samples, metrics.optimizer_steps };
+            const double values[] = { metrics.seconds, metrics.samples_per_second, metrics.input_seconds,
+                metrics.forward_seconds, metrics.backward_seconds, metrics.optimizer_seconds, metrics.loss,
+                metrics.running_loss, metrics.gradient_norm };
+            std::string result;
+            char text[64];
+            for (size_t i = 0; i < std::size(field_names); i++)
+            {
+                if (i != 0) result += separator;
+                if (named) result.append("\"").append(field_names[i]).append("\":");
+                const double value = i < std::size(counts) ? 0.0 : values[i - std::size(counts)];
+                if (i < std::size(counts)) std::snprintf(text, sizeof(text), "%zu", counts[i]);
+                else if (named && !std::isfinite(value)) std::snprintf(text, sizeof(text), "null");
+                else std::snprintf(text, sizeof(text), "%.9g", value);
+                result += text;
+            }
+            return result;
+        }
+
+        std::shared_ptr<std::ofstream> open_file(const std::string& path)
+        {
+            auto stream = std::make_shared<std::ofstream>(path);
+            if (!*stream) throw IOException("Failed to open the metrics file");
+            return stream;
+        }
+    }
+
+    MetricsSink csv(std::ostream& stream)
+    {
+        return [&stream, header = true](const StepMetrics& metrics) mutable
+        {
+            if (header)
+            {
+                for (size_t i = 0; i < std::size(field_names); i++) stream << (i == 0 ? "" : ",") << field_names[i];
+                stream << '\n';
+                header = false;
+            }
+            // Flushing every batch keeps the file useful for watching a running job
+            stream << format_values(metrics, ",", false) << std::endl;
+        };
+    }
+
+    MetricsSink csv(const std::string& path)
+    {
+        const std::shared_ptr<std::ofstream> stream = open_file(path);
+        return [stream, sink = csv(*stream)](const StepMetrics& metrics) { sink(metrics); };
+    }
+
+    MetricsSink json_lines(std::ostream& stream)
+    {
+        return [&stream](const StepMetrics& metrics)
+        {
+            stream << '{' << format_values(metrics, ",", true) << '}' << std::endl;
+        };
+    }
+
+    MetricsSink json_lines(const std::string& path)
+    {
+        const std::shared_ptr<std::ofstream> stream = open_file(path);
+        return [stream, sink = json_lines(*stream)](const StepMetrics& metrics) { sink(metrics); };
+    }
+}
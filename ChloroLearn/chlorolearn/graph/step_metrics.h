@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace chloro
+{
+    /**
+     * \brief Telemetry of a batch of training in \c Graph::optimize, see \c Graph::set_metrics_sink.
+     * \details The times of the phases are measured around every sample with a steady clock, which costs a
+     * few clock reads per sample. The seconds not covered by the phases are mostly spent on clearing the
+     * nodes and calling the callbacks.
+     */
+    struct StepMetrics final
+    {
+        size_t batch = 0; /**< \brief Index of the batch since the optimization started. */
+        size_t epoch = 0; /**< \brief Index of the epoch of the last sample of the batch. */
+        size_t samples = 0; /**< \brief Amount of samples in the batch. */
+        size_t optimizer_steps = 0; /**< \brief Amount of times the optimizer was applied in the batch. */
+        double seconds = 0.0; /**< \brief Wall time of the batch. */
+        double samples_per_second = 0.0; /**< \brief Throughput of the batch. */
+        double input_seconds = 0.0; /**< \brief Time spent on loading the samples, including waiting for them. */
+        double forward_seconds = 0.0; /**< \brief Time spent on forward propagation. */
+        double backward_seconds = 0.0; /**< \brief Time spent on back propagation. */
+        /** \brief Time spent on applying the optimizer, including measuring the gradient norm. */
+        double optimizer_seconds = 0.0;
+        double loss = 0.0; /**< \brief Mean of the sums of the target over the samples of the batch. */
+        double running_loss = 0.0; /**< \brief Mean of the sums of the target over the epoch so far. */
+        /** \brief L2 norm of the gradients of all the parameters at the last optimizer step, 0 if none. */
+        double gradient_norm = 0.0;
+    };
+
+    /** \brief Receives the metrics of every batch of training. */
+    using MetricsSink = std::function<void(const StepMetrics&)>;
+
+    /** \brief Provide sinks which write the metrics of every batch as a line of text. */
+    namespace metrics_sinks
+    {
+        /**
+         * \brief A sink writing comma separated values, starting with a header line.
+         * \param stream The stream to write into, which should outlive the sink.
+         * \return The result sink.
+         */
+        MetricsSink csv(std::ostream& stream);
+        /**
+         * \brief A sink writing comma separated values into a file, starting with a header line.
+         * \param path The full path or relative path to the file, which is overwritten.
+         * \return The result sink.
+         */
+        MetricsSink csv(const std::string& path);
+        /**
+         * \brief A sink writing a JSON object per line.
+         * \param stream The stream to write into, which should outlive the sink.
+         * \return The result sink.
+         */
+        MetricsSink json_lines(std::ostream& stream);
+        /**
+         * \brief A sink writing a JSON object per line into a file.
+         * \param path The full path or relative path to the file, which is overwritten.
+         * \return The result sink.
+         */
+        MetricsSink json_lines(const std::string& path);
+    }
+}
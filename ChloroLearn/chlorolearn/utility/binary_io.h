@@ -1,8 +1,13 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <string>
 #include <fstream>
 #include <vector>
 
+#include "../basic/exceptions.h"
+
 namespace chloro
 {
     // Binary input
@@ -55,18 +60,94 @@ namespace chloro
         stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
     }
     /**
-     * \brief Write an \c std::vector to a binary stream.
+     * \brief Write an \c std::vector or another contiguous container to a binary stream.
      * \details The function will first write a \c size_t, the size of the vector to the stream,
      * and then the values saved in the vector.
-     * \tparam T Type of the value to be written
+     * \tparam Container Type of the container, like \c std::vector or \c ArrayBuffer.
      * \param stream The stream to which the value is written
      * \param values The vector to be written.
      */
-    template <typename T>
-    void write_vector(std::ofstream& stream, const std::vector<T>& values)
+    template <typename Container>
+    void write_vector(std::ofstream& stream, const Container& values)
     {
+        using T = typename Container::value_type;
         const uint64_t size = values.size();
         write(stream, size);
-        stream.write(reinterpret_cast<const char*>(&values[0]), size * sizeof(T));
+        stream.write(reinterpret_cast<const char*>(values.data()), size * sizeof(T));
     }
+
+    /**
+     * \brief Multiply two sizes read from a file, which are untrusted, so the product must not wrap around.
+     * \param message Message of the \c IOException thrown if the product overflows.
+     */
+    inline size_t checked_multiply(const size_t left, const size_t right, const char* message)
+    {
+        if (right != 0 && left > size_t(-1) / right) throw IOException(message);
+        return left * right;
+    }
+
+    // Binary buffers
+
+    /** \brief Serializes values into a byte buffer in the native byte order. */
+    class ByteWriter final
+    {
+    private:
+        std::vector<char> bytes_;
+    public:
+        /** \brief Append a trivially copyable value. */
+        template <typename T>
+        void write(const T& value)
+        {
+            const char* pointer = reinterpret_cast<const char*>(&value);
+            bytes_.insert(bytes_.end(), pointer, pointer + sizeof(T));
+        }
+        /** \brief Append a string, prefixed with its length as a \c uint32_t. */
+        void write_string(const std::string& string)
+        {
+            write(uint32_t(string.size()));
+            bytes_.insert(bytes_.end(), string.begin(), string.end());
+        }
+        /** \brief Get the written bytes. */
+        const std::vector<char>& bytes() const { return bytes_; }
+    };
+
+    /** \brief Deserializes values from a byte range written by \c ByteWriter, with bounds checking. */
+    class ByteReader final
+    {
+    private:
+        const char* data_;
+        size_t size_;
+        size_t offset_ = 0;
+    public:
+        /** \brief Constructs a reader of a byte range. */
+        ByteReader(const char* data, const size_t size) :data_(data), size_(size) {}
+        /** \brief Copy the next bytes into some memory, throws if there are not enough bytes left. */
+        void read_bytes(void* data, const size_t size)
+        {
+            if (size > size_ - offset_) throw IOException("The data is truncated");
+            std::memcpy(data, data_ + offset_, size);
+            offset_ += size;
+        }
+        /** \brief Read a trivially copyable value. */
+        template <typename T>
+        T read()
+        {
+            T value;
+            read_bytes(&value, sizeof(T));
+            return value;
+        }
+        /** \brief Read a string written by \c ByteWriter::write_string. */
+        std::string read_string()
+        {
+            const size_t length = read<uint32_t>();
+            if (length > size_ - offset_) throw IOException("The data is truncated");
+            std::string result(data_ + offset_, length);
+            offset_ += length;
+            return result;
+        }
+        /** \brief Get the amount of bytes read so far. */
+        size_t offset() const { return offset_; }
+        /** \brief Get the amount of bytes left to read. */
+        size_t remaining() const { return size_ - offset_; }
+    };
 }
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <random>
+
+#include "checkpoint.h"
+#include "binary_io.h"
+#include "crc32.h"
+
+namespace chloro
+{
+    namespace
+    {
+        constexpr char checkpoint_magic[8] = { 'C', 'H', 'L', 'C', 'K', 'P', 'T', '\0' };
+        constexpr size_t checkpoint_alignment = 64;
+        // Magic, version, entry count, index size and index checksum
+        constexpr size_t header_size = sizeof(checkpoint_magic) + 4 + 4 + 8 + 4;
+        // Name length, dimension, offset, size and checksum, the least an index entry takes in any version
+        constexpr size_t min_entry_size = 4 + 8 + 8 + 8 + 4;
+
+        size_t align_up(const size_t offset)
+        {
+            return (offset + checkpoint_alignment - 1) / checkpoint_alignment * checkpoint_alignment;
+        }
+    }
+
+    std::string unique_temporary_path(const std::string& path)
+    {
+        static const uint32_t process_token = std::random_device{}();
+        static std::atomic<uint64_t> counter{ 0 };
+        return path + "." + std::to_string(process_token) + "-" + std::to_string(counter++) + ".tmp";
+    }
+
+    uint32_t write_checkpoint(const std::string& path, const std::vector<CheckpointEntry>& entries,
+        const Precision precision, const std::string& metadata)
+    {
+        // Convert the values first, since the index contains the checksums of the stored bytes
+        std::vector<std::vector<char>> converted;
+        std::vector<const char*> data;
+        for (const CheckpointEntry& entry : entries)
+            if (precision == Precision::float64)
+                data.push_back(reinterpret_cast<const char*>(entry.values));
+            else
+            {
+                std::vector<char>& bytes = converted.emplace_back(encoded_size(precision, entry.shape));
+                encode(precision, entry.values, entry.shape, bytes.data());
+                data.push_back(bytes.data());
+            }
+        // The index stores the offsets of the values, so its size has to be known first
+        size_t index_size = 0;
+        for (const CheckpointEntry& entry : entries)
+            index_size += 4 + entry.name.size() + 8 + 8 * entry.shape.size() + 4 + 8 + 8 + 4;
+        index_size += 4 + metadata.size();
+        ByteWriter index;
+        size_t offset = align_up(header_size + index_size);
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const CheckpointEntry& entry = entries[i];
+            const size_t bytes = encoded_size(precision, entry.shape);
+            index.write_string(entry.name);
+            index.write(uint64_t(entry.shape.size()));
+            for (const size_t length : entry.shape) index.write(uint64_t(length));
+            index.write(uint32_t(precision));
+            index.write(uint64_t(offset));
+            index.write(uint64_t(bytes));
+            index.write(crc32(data[i], bytes));
+            offset = align_up(offset + bytes);
+        }
+        index.write_string(metadata);
+        const uint32_t fingerprint = crc32(index.bytes().data(), index_size);
+        const std::string temporary_path = unique_temporary_path(path);
+        try
+        {
+            std::ofstream stream(temporary_path, std::ios::out | std::ios::binary);
+            if (!stream.good()) throw IOException("Failed to open the file");
+            stream.write(checkpoint_magic, sizeof(checkpoint_magic));
+            write(stream, Checkpoint::version);
+            write(stream, uint32_t(entries.size()));
+            write(stream, uint64_t(index_size));
+            write(stream, fingerprint);
+            stream.write(index.bytes().data(), std::streamsize(index_size));
+            const auto pad = [&stream]
+            {
+                const size_t position = size_t(stream.tellp());
+                for (size_t i = position; i < align_up(position); i++) stream.put('\0');
+            };
+            pad();
+            for (size_t i = 0; i < entries.size(); i++)
+            {
+                stream.write(data[i], std::streamsize(encoded_size(precision, entries[i].shape)));
+                pad();
+            }
+            stream.close();
+            if (stream.fail()) throw IOException("Failed to write the checkpoint file");
+            std::error_code error;
+            std::filesystem::rename(temporary_path, path, error);
+            if (error) throw IOException("Failed to replace the checkpoint file");
+        }
+        catch (...)
+        {
+            std::error_code error;
+            std::filesystem::remove(temporary_path, error);
+            throw;
+        }
+        return fingerprint;
+    }
+
+    Checkpoint::Checkpoint(const std::string& path, const bool verify) :map_(path)
+    {
+        ByteReader header(map_.data(), map_.size());
+        char magic[sizeof(checkpoint_magic)];
+        for (char& c : magic) c = header.read<char>();
+        if (std::memcmp(magic, checkpoint_magic, sizeof(checkpoint_magic)) != 0)
+            throw IOException("The file is not a checkpoint file");
+        const uint32_t file_version = header.read<uint32_t>();
+        if (file_version == 0 || file_version > version) throw IOException("Unsupported checkpoint version");
+        const size_t count = header.read<uint32_t>();
+        const size_t index_size = size_t(header.read<uint64_t>());
+        fingerprint_ = header.read<uint32_t>();
+        // The header was read, so the file is at least header_size long
+        if (index_size > map_.size() - header_size) throw IOException("The checkpoint file is truncated");
+        if (crc32(map_.data() + header_size, index_size) != fingerprint_)
+            throw IOException("The checkpoint index is corrupted");
+        ByteReader reader(map_.data() + header_size, index_size);
+        constexpr const char* invalid = "The checkpoint index is invalid";
+        if (count > reader.remaining() / min_entry_size) throw IOException(invalid);
+        entries_.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            Entry& entry = entries_[i];
+            entry.name = reader.read_string();
+            const uint64_t dimension = reader.read<uint64_t>();
+            if (dimension > ArrayShape::max_dimension) throw IOException(invalid);
+            entry.shape.resize(size_t(dimension));
+            for (size_t j = 0; j < entry.shape.size(); j++) entry.shape.set(j, size_t(reader.read<uint64_t>()));
+            // Bounding the values and the int8 scales by 8 bytes each keeps encoded_size from wrapping around
+            size_t element_count = 1;
+            for (const size_t length : entry.shape) element_count = checked_multiply(element_count, length, invalid);
+            checked_multiply(std::max(element_count, entry.shape.empty() ? size_t(0) : entry.shape[0]),
+                sizeof(double), invalid);
+            if (file_version >= 2)
+            {
+                const uint32_t precision = reader.read<uint32_t>();
+                if (precision > uint32_t(Precision::int8)) throw IOException("Unknown precision in the checkpoint");
+                entry.precision = Precision(precision);
+            }
+            entry.offset = size_t(reader.read<uint64_t>());
+            // Version 1 stores the amount of values instead of bytes
+            entry.bytes = size_t(reader.read<uint64_t>()) * (file_version == 1 ? sizeof(double) : 1);
+            entry.checksum = reader.read<uint32_t>();
+            if (entry.bytes != encoded_size(entry.precision, entry.shape) || entry.offset % checkpoint_alignment != 0
+                || entry.offset > map_.size() || entry.bytes > map_.size() - entry.offset)
+                throw IOException(invalid);
+            if (!index_.emplace(entry.name, i).second)
+                throw IOException("Duplicate array names in the checkpoint");
+        }
+        if (file_version >= 3) metadata_ = reader.read_string();
+        if (verify) this->verify();
+    }
+
+    const Checkpoint::Entry& Checkpoint::find(const std::string& name) const
+    {
+        const auto iter = index_.find(name);
+        if (iter == index_.end()) throw IllegalArgumentException("No array of the name in the checkpoint");
+        return entries_[iter->second];
+    }
+
+    void Checkpoint::verify() const
+    {
+        for (const Entry& entry : entries_)
+            if (crc32(map_.data() + entry.offset, entry.bytes) != entry.checksum)
+                throw IOException("The checkpoint data is corrupted");
+    }
+
+    std::vector<std::string> Checkpoint::names() const
+    {
+        std::vector<std::string> result;
+        result.reserve(entries_.size());
+        for (const Entry& entry : entries_) result.push_back(entry.name);
+        return result;
+    }
+
+    Array<double> Checkpoint::view(const std::string& name) const
+    {
+        const Entry& entry = find(name);
+        if (entry.precision != Precision::float64)
+            throw IllegalOperationException("Only arrays stored in double precision can be viewed");
+        return Array<double>::view(reinterpret_cast<double*>(map_.data() + entry.offset), entry.shape);
+    }
+
+    Array<double> Checkpoint::read(const std::string& name) const
+    {
+        const Entry& entry = find(name);
+        Array<double> result = Array<double>::zeros(entry.shape);
+        decode(entry.precision, map_.data() + entry.offset, entry.shape, &result[0]);
+        return result;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "../basic/array.h"
+#include "memory_map.h"
+#include "precision.h"
+
+namespace chloro
+{
+    /** \brief A named array to be written into a checkpoint file. */
+    struct CheckpointEntry final
+    {
+        std::string name; /**< \brief Name of the array, which should be unique in a checkpoint. */
+        ArrayShape shape; /**< \brief Shape of the array. */
+        const double* values = nullptr; /**< \brief Pointer to the values of the array. */
+    };
+
+    /**
+     * \brief Get a temporary path next to a file, for writing the file before renaming it into place.
+     * \details The path is unique to the call, even among different processes, so concurrent writes of the
+     * same file never share a temporary file.
+     * \param path The full path or relative path to the file.
+     * \return The temporary path.
+     */
+    std::string unique_temporary_path(const std::string& path);
+
+    /**
+     * \brief Write some named arrays into a checkpoint file.
+     * \details A checkpoint file starts with a header and an index of the names, shapes, offsets and CRC-32
+     * checksums of the arrays, followed by the values of the arrays, each starting at a 64 bytes boundary so
+     * that they can be memory mapped and used in place. The file is written under a temporary name unique to
+     * the write and then renamed, so an existing checkpoint is never left half overwritten, even by concurrent
+     * writes.
+     * \param path The full path or relative path to the checkpoint file.
+     * \param entries The arrays to write.
+     * \param precision Precision of the stored values. Reduced precisions make smaller files for deployment,
+     * but arrays stored in them are converted when loaded instead of being used in place.
+     * \param metadata Arbitrary bytes stored in the index, like a serialized graph.
+     * \return The fingerprint of the checkpoint, see \c Checkpoint::fingerprint.
+     */
+    uint32_t write_checkpoint(const std::string& path, const std::vector<CheckpointEntry>& entries,
+        Precision precision = Precision::float64, const std::string& metadata = {});
+
+    /**
+     * \brief A memory mapped checkpoint file written by \c write_checkpoint.
+     * \details Arrays in the checkpoint are accessed as views of the mapped memory. The mapping is copy-on-write,
+     * so the views can be modified (for example trained) without changing the file.
+     */
+    class Checkpoint final
+    {
+    private:
+        struct Entry
+        {
+            std::string name;
+            ArrayShape shape;
+            size_t offset = 0;
+            size_t bytes = 0;
+            Precision precision = Precision::float64;
+            uint32_t checksum = 0;
+        };
+        MemoryMap map_;
+        std::vector<Entry> entries_;
+        std::unordered_map<std::string, size_t> index_;
+        uint32_t fingerprint_ = 0;
+        std::string metadata_;
+        const Entry& find(const std::string& name) const;
+    public:
+        /**
+         * \brief Current version of the checkpoint format.
+         * \details Version 2 added the precision of the arrays, and version 3 added the metadata. Files of
+         * older versions can still be read.
+         */
+        static constexpr uint32_t version = 3;
+        /**
+         * \brief Map a checkpoint file and read its index.
+         * \param path The full path or relative path to the checkpoint file.
+         * \param verify Whether to check the checksums of all the arrays when opening the file, which reads
+         * the whole file. The checksum of the index is always checked.
+         */
+        explicit Checkpoint(const std::string& path, bool verify = true);
+        /** \brief Check the checksums of all the arrays, throws if the file is corrupted. */
+        void verify() const;
+        /**
+         * \brief Get the fingerprint of the checkpoint, that is the checksum of its index.
+         * \details Since the index contains the checksums of the arrays, the fingerprint identifies the
+         * contents of the checkpoint, and is used by delta checkpoints for referring to their base.
+         */
+        uint32_t fingerprint() const { return fingerprint_; }
+        /** \brief Get the metadata stored in the checkpoint, empty if there's none. */
+        const std::string& metadata() const { return metadata_; }
+        /** \brief Get the amount of arrays in the checkpoint. */
+        size_t size() const { return entries_.size(); }
+        /** \brief Get the names of the arrays in the order they are stored. */
+        std::vector<std::string> names() const;
+        /** \brief Check whether the checkpoint contains an array of some name. */
+        bool contains(const std::string& name) const { return index_.count(name) != 0; }
+        /** \brief Get the shape of an array. */
+        const ArrayShape& shape(const std::string& name) const { return find(name).shape; }
+        /** \brief Get the precision an array is stored in. */
+        Precision precision(const std::string& name) const { return find(name).precision; }
+        /**
+         * \brief Get an array stored in double precision as a view of the mapped memory.
+         * \remark The checkpoint should outlive the view.
+         */
+        Array<double> view(const std::string& name) const;
+        /** \brief Get a copy of an array, converting it into doubles if needed. */
+        Array<double> read(const std::string& name) const;
+    };
+}
@@ -0,0 +1,44 @@
+#include <array>
+
+#include "crc32.h"
+
+namespace chloro
+{
+    namespace
+    {
+        // Tables for processing 8 bytes at a time (slicing-by-8)
+        using CrcTables = std::array<std::array<uint32_t, 256>, 8>;
+
+        CrcTables make_tables()
+        {
+            CrcTables tables{};
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t crc = i;
+                for (int j = 0; j < 8; j++) crc = crc & 1 ? crc >> 1 ^ 0xEDB88320u : crc >> 1;
+                tables[0][i] = crc;
+            }
+            for (uint32_t i = 0; i < 256; i++)
+                for (size_t j = 1; j < 8; j++)
+                    tables[j][i] = tables[j - 1][i] >> 8 ^ tables[0][tables[j - 1][i] & 0xFF];
+            return tables;
+        }
+    }
+
+    uint32_t crc32(const void* data, size_t size, uint32_t crc)
+    {
+        static const CrcTables tables = make_tables();
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        crc = ~crc;
+        for (; size >= 8; size -= 8, bytes += 8)
+        {
+            const uint32_t low = crc ^ (uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 |
+                uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24);
+            crc = tables[7][low & 0xFF] ^ tables[6][low >> 8 & 0xFF] ^
+                tables[5][low >> 16 & 0xFF] ^ tables[4][low >> 24] ^
+                tables[3][bytes[4]] ^ tables[2][bytes[5]] ^ tables[1][bytes[6]] ^ tables[0][bytes[7]];
+        }
+        for (; size > 0; size--, bytes++) crc = crc >> 8 ^ tables[0][(crc ^ *bytes) & 0xFF];
+        return ~crc;
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace chloro
+{
+    /**
+     * \brief Compute the CRC-32 (IEEE 802.3) checksum of a block of memory.
+     * \param data Pointer to the first byte.
+     * \param size Amount of bytes.
+     * \param crc Checksum of the preceding blocks, for computing the checksum of consecutive blocks.
+     * \return The checksum of all the blocks so far.
+     */
+    uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
+}
@@ -0,0 +1,148 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "data_source.h"
+#include "binary_io.h"
+#include "split.h"
+
+namespace chloro
+{
+    namespace
+    {
+        constexpr char shard_magic[8] = { 'C', 'H', 'L', 'S', 'H', 'A', 'R', 'D' };
+        constexpr uint32_t shard_version = 1;
+        constexpr size_t shard_alignment = 64;
+
+        size_t align_up(const size_t offset) { return (offset + shard_alignment - 1) / shard_alignment * shard_alignment; }
+    }
+
+    PackDataSource::PackDataSource(std::vector<std::reference_wrapper<const DataValues>> packs) :packs_(std::move(packs))
+    {
+        if (packs_.empty()) throw IllegalArgumentException("There should be at least one input pack");
+        const size_t size = packs_[0].get().size();
+        if (size == 0) throw IllegalArgumentException("Input packs should not be empty");
+        for (const DataValues& pack : packs_)
+            if (pack.size() != size) throw MismatchedSizesException("Input packs should be of the same size");
+    }
+
+    void PackDataSource::fetch(const size_t index, const size_t field, Array<double>& out) const
+    {
+        const Array<double>& value = packs_[field].get()[index];
+        if (out.shape() == value.shape() && !out.is_view())
+            out.assign(value);
+        else
+            out = value;
+    }
+
+    ShardDataSource::ShardDataSource(const std::vector<std::string>& paths)
+    {
+        if (paths.empty()) throw IllegalArgumentException("There should be at least one shard");
+        for (const std::string& path : paths)
+        {
+            Shard shard{ MemoryMap(path), size_, {} };
+            ByteReader reader(shard.map.data(), shard.map.size());
+            char magic[sizeof(shard_magic)];
+            for (char& c : magic) c = reader.read<char>();
+            if (std::memcmp(magic, shard_magic, sizeof(shard_magic)) != 0)
+                throw IOException("The file is not a shard file");
+            if (reader.read<uint32_t>() != shard_version) throw IOException("Unsupported shard version");
+            const size_t field_count = reader.read<uint32_t>();
+            const size_t sample_count = size_t(reader.read<uint64_t>());
+            // Every field takes at least the length of its dimension in the header
+            if (field_count > reader.remaining() / sizeof(uint64_t)) throw IOException("The shard file is truncated");
+            if (sample_count > size_t(-1) - size_) throw IOException("The shard file is invalid");
+            std::vector<ArrayShape> shapes(field_count);
+            for (ArrayShape& shape : shapes)
+            {
+                const uint64_t dimension = reader.read<uint64_t>();
+                if (dimension > ArrayShape::max_dimension) throw IOException("The shard file is invalid");
+                shape.resize(size_t(dimension));
+                for (size_t i = 0; i < shape.size(); i++) shape.set(i, size_t(reader.read<uint64_t>()));
+            }
+            if (!shards_.empty() && shapes != shapes_)
+                throw MismatchedSizesException("Shards should have the same fields");
+            size_t offset = align_up(reader.offset());
+            for (const ArrayShape& shape : shapes)
+            {
+                constexpr const char* invalid = "The shard file is invalid";
+                size_t field_size = 1;
+                for (const size_t length : shape) field_size = checked_multiply(field_size, length, invalid);
+                const size_t bytes = checked_multiply(checked_multiply(sample_count, field_size, invalid),
+                    sizeof(double), invalid);
+                // The values of the field must end within the file, the padding after them may be cut off
+                if (offset > shard.map.size() || bytes > shard.map.size() - offset)
+                    throw IOException("The shard file is truncated");
+                shard.fields.push_back(reinterpret_cast<double*>(shard.map.data() + offset));
+                offset = align_up(offset + bytes);
+                if (shards_.empty()) field_sizes_.push_back(field_size);
+            }
+            if (shards_.empty()) shapes_ = std::move(shapes);
+            size_ += sample_count;
+            shards_.push_back(std::move(shard));
+        }
+    }
+
+    void ShardDataSource::fetch(const size_t index, const size_t field, Array<double>& out) const
+    {
+        if (index >= size_) throw ArgumentOutOfRangeException("Sample index out of range");
+        // Find the last shard starting at or before the index
+        const auto iter = std::upper_bound(shards_.begin(), shards_.end(), index,
+            [](const size_t value, const Shard& shard) { return value < shard.first; }) - 1;
+        const size_t size = field_sizes_[field];
+        out = Array<double>::view(iter->fields[field] + (index - iter->first) * size, shapes_[field]);
+    }
+
+    DataSubset::DataSubset(const DataSource& source, std::vector<size_t> indices) :
+        source_(source), indices_(std::move(indices))
+    {
+        const size_t size = source_.size();
+        for (const size_t index : indices_)
+            if (index >= size) throw ArgumentOutOfRangeException("Sample index out of range");
+    }
+
+    std::pair<DataSubset, DataSubset> train_test_split(const DataSource& source, const double train_ratio,
+        const uint64_t seed)
+    {
+        IndexSplit split = index_split(source.size(), train_ratio, seed);
+        return { DataSubset(source, std::move(split.train)), DataSubset(source, std::move(split.test)) };
+    }
+
+    void write_shard(const std::string& path, const DataSource& source, const size_t begin, size_t end)
+    {
+        end = std::min(end, source.size());
+        if (begin > end) throw ArgumentOutOfRangeException("Sample range is invalid");
+        std::ofstream stream(path, std::ios::out | std::ios::binary);
+        if (!stream.good()) throw IOException("Failed to open the file");
+        const size_t field_count = source.field_count();
+        stream.write(shard_magic, sizeof(shard_magic));
+        write(stream, shard_version);
+        write(stream, uint32_t(field_count));
+        write(stream, uint64_t(end - begin));
+        for (size_t i = 0; i < field_count; i++)
+        {
+            const ArrayShape& shape = source.shape(i);
+            write(stream, uint64_t(shape.size()));
+            for (const size_t length : shape) write(stream, uint64_t(length));
+        }
+        const auto pad = [&stream]
+        {
+            const size_t offset = size_t(stream.tellp());
+            for (size_t i = offset; i < align_up(offset); i++) stream.put('\0');
+        };
+        pad();
+        Array<double> value;
+        for (size_t i = 0; i < field_count; i++)
+        {
+            for (size_t j = begin; j < end; j++)
+            {
+                source.fetch(j, i, value);
+                if (value.shape() != source.shape(i))
+                    throw MismatchedSizesException("Samples should have the same shape in a field");
+                stream.write(reinterpret_cast<const char*>(value.data().data()), value.size() * sizeof(double));
+            }
+            pad();
+        }
+        if (!stream.good()) throw IOException("Failed to write the shard file");
+    }
+}
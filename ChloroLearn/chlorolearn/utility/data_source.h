@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <functional>
+#include <utility>
+
+#include "../basic/array.h"
+#include "memory_map.h"
+#include "utility.h"
+
+namespace chloro
+{
+    /**
+     * \brief An interface for datasets that can be consumed by \c Graph::optimize.
+     * \details A dataset consists of \c size() samples, each of which contains \c field_count() arrays,
+     * for example an image and its label. Every field feeds one \c Input node when training.
+     */
+    class DataSource
+    {
+    public:
+        virtual ~DataSource() = default; /**< \brief Virtual destructor. */
+        /** \brief Get the amount of samples in the dataset. */
+        virtual size_t size() const = 0;
+        /** \brief Get the amount of arrays in every sample. */
+        virtual size_t field_count() const = 0;
+        /** \brief Get the shape of a field. */
+        virtual const ArrayShape& shape(size_t field) const = 0;
+        /**
+         * \brief Load a field of a sample into an array.
+         * \details Implementations either copy the values into \a out, reusing its storage if possible, or
+         * turn \a out into a view of memory owned by the data source, which then stays valid as long as the
+         * data source does.
+         * \param index Index of the sample.
+         * \param field Index of the field.
+         * \param out The array to load the values into.
+         * \remark This method may be called from a background thread, so it should not modify shared state.
+         */
+        virtual void fetch(size_t index, size_t field, Array<double>& out) const = 0;
+    };
+
+    /** \brief A data source over input packs, that is vectors of arrays in memory. */
+    class PackDataSource final : public DataSource
+    {
+    private:
+        std::vector<std::reference_wrapper<const DataValues>> packs_;
+    public:
+        /**
+         * \brief Constructs a data source over some packs, every pack is a field of the samples.
+         * \param packs The packs, which should be non-empty and of the same size.
+         * \remark The packs are referenced instead of copied, so they should outlive the data source.
+         */
+        explicit PackDataSource(std::vector<std::reference_wrapper<const DataValues>> packs);
+        size_t size() const override { return packs_[0].get().size(); } /**< \copydoc DataSource::size */
+        size_t field_count() const override { return packs_.size(); } /**< \copydoc DataSource::field_count */
+        /** \copydoc DataSource::shape */
+        const ArrayShape& shape(const size_t field) const override { return packs_[field].get()[0].shape(); }
+        /** \brief Copy a field of a sample into an array. */
+        void fetch(size_t index, size_t field, Array<double>& out) const override;
+    };
+
+    /**
+     * \brief A data source over memory mapped binary shard files.
+     * \details Samples of a shard are stored contiguously field by field, so loading a shard takes no time
+     * regardless of its size, and samples are only read from the disk when they are fetched, which makes
+     * datasets larger than the memory usable. Fetched arrays are views of the mapped memory. Shard files can
+     * be written with \c write_shard.
+     */
+    class ShardDataSource final : public DataSource
+    {
+    private:
+        struct Shard
+        {
+            MemoryMap map;
+            size_t first = 0;
+            std::vector<double*> fields;
+        };
+        std::vector<Shard> shards_;
+        std::vector<ArrayShape> shapes_;
+        std::vector<size_t> field_sizes_;
+        size_t size_ = 0;
+    public:
+        /**
+         * \brief Map some shard files, which should have the same fields.
+         * \param paths Paths to the shard files, samples are indexed in the order of the shards.
+         */
+        explicit ShardDataSource(const std::vector<std::string>& paths);
+        size_t size() const override { return size_; } /**< \copydoc DataSource::size */
+        size_t field_count() const override { return shapes_.size(); } /**< \copydoc DataSource::field_count */
+        /** \copydoc DataSource::shape */
+        const ArrayShape& shape(const size_t field) const override { return shapes_[field]; }
+        /** \brief Turn an array into a view of a field of a sample in the mapped memory. */
+        void fetch(size_t index, size_t field, Array<double>& out) const override;
+    };
+
+    /**
+     * \brief A data source consisting of some samples of another data source, selected by their indices.
+     * \details Only the indices are stored, fetching a sample forwards to the underlying data source, so
+     * subsets never copy sample data.
+     */
+    class DataSubset final : public DataSource
+    {
+    private:
+        const DataSource& source_;
+        std::vector<size_t> indices_;
+    public:
+        /**
+         * \brief Constructs a subset of a data source.
+         * \param source The underlying data source, which should outlive the subset.
+         * \param indices Indices of the selected samples in the underlying data source.
+         */
+        DataSubset(const DataSource& source, std::vector<size_t> indices);
+        size_t size() const override { return indices_.size(); } /**< \copydoc DataSource::size */
+        size_t field_count() const override { return source_.field_count(); } /**< \copydoc DataSource::field_count */
+        /** \copydoc DataSource::shape */
+        const ArrayShape& shape(const size_t field) const override { return source_.shape(field); }
+        /** \brief Fetch a field of a sample from the underlying data source. */
+        void fetch(const size_t index, const size_t field, Array<double>& out) const override
+        {
+            source_.fetch(indices_[index], field, out);
+        }
+        /** \brief Get the indices of the selected samples in the underlying data source. */
+        const std::vector<size_t>& indices() const { return indices_; }
+    };
+
+    /**
+     * \brief Split a data source to training set and test set without copying the samples.
+     * \param source The data source that needs to be splitted, which should outlive the subsets.
+     * \param train_ratio The propotion of training set to the whole set of samples.
+     * \param seed Seed of the shuffling, the same seed always results in the same split, see \c IndexSplit.
+     * \return The training set and the test set.
+     */
+    std::pair<DataSubset, DataSubset> train_test_split(const DataSource& source, double train_ratio = 0.8,
+        uint64_t seed = 0);
+
+    /**
+     * \brief Write samples of a data source into a shard file that can be read by \c ShardDataSource.
+     * \param path The full path or relative path to the shard file.
+     * \param source The data source containing the samples.
+     * \param begin Index of the first written sample.
+     * \param end Index past the last written sample, defaults to the size of the data source.
+     */
+    void write_shard(const std::string& path, const DataSource& source, size_t begin = 0, size_t end = size_t(-1));
+}
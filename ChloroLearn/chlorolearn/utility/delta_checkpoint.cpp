@@ -0,0 +1,225 @@
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+#include "delta_checkpoint.h"
+#include "crc32.h"
+#include "binary_io.h"
+
+namespace chloro
+{
+    namespace
+    {
+        constexpr char delta_magic[8] = { 'C', 'H', 'L', 'D', 'E', 'L', 'T', 'A' };
+        constexpr uint32_t delta_version = 1;
+
+        // Writes values into a file while computing their checksum
+        class ChecksumWriter
+        {
+        private:
+            std::ofstream& stream_;
+            uint32_t crc_ = 0;
+        public:
+            explicit ChecksumWriter(std::ofstream& stream) :stream_(stream) {}
+            void write_bytes(const void* data, const size_t size)
+            {
+                stream_.write(static_cast<const char*>(data), std::streamsize(size));
+                crc_ = crc32(data, size, crc_);
+            }
+            template <typename T>
+            void write(const T& value) { write_bytes(&value, sizeof(T)); }
+            uint32_t checksum() const { return crc_; }
+        };
+    }
+
+    DeltaCheckpointWriter::DeltaCheckpointWriter(std::string path, const double threshold, const size_t block_size,
+        const size_t full_interval) :
+        path_(std::move(path)), threshold_(threshold), block_size_(block_size), full_interval_(full_interval)
+    {
+        if (threshold_ < 0) throw IllegalArgumentException("The threshold should not be negative");
+        if (block_size_ == 0) throw IllegalArgumentException("The block size should be positive");
+    }
+
+    void DeltaCheckpointWriter::remove_deltas()
+    {
+        std::error_code error;
+        for (const std::string& delta_path : delta_paths_) std::filesystem::remove(delta_path, error);
+        delta_paths_.clear();
+    }
+
+    void DeltaCheckpointWriter::write(const std::vector<CheckpointEntry>& entries)
+    {
+        if (names_.empty() || delta_paths_.size() >= full_interval_)
+            write_full(entries);
+        else
+            write_delta(entries);
+    }
+
+    void DeltaCheckpointWriter::write_full(const std::vector<CheckpointEntry>& entries)
+    {
+        fingerprint_ = write_checkpoint(path_, entries);
+        // The old deltas don't apply to the new base anymore
+        remove_deltas();
+        names_.clear();
+        written_.clear();
+        for (const CheckpointEntry& entry : entries)
+        {
+            names_.push_back(entry.name);
+            const Array<double> view = Array<double>::view(const_cast<double*>(entry.values), entry.shape);
+            written_.push_back(view); // Copying a view results in an owning copy
+        }
+    }
+
+    void DeltaCheckpointWriter::write_delta(const std::vector<CheckpointEntry>& entries)
+    {
+        if (names_.empty()) throw IllegalOperationException("A full checkpoint should be written before deltas");
+        const size_t count = entries.size();
+        if (count != names_.size()) throw MismatchedSizesException("Arrays don't match those of the base checkpoint");
+        for (size_t i = 0; i < count; i++)
+            if (entries[i].name != names_[i] || entries[i].shape != written_[i].shape())
+                throw MismatchedSizesException("Arrays don't match those of the base checkpoint");
+        // Find the changed blocks of every array
+        std::vector<std::vector<size_t>> changed(count);
+        size_t changed_entries = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const size_t size = written_[i].size();
+            const double* values = entries[i].values;
+            const double* written = written_[i].data().data();
+            for (size_t begin = 0; begin < size; begin += block_size_)
+            {
+                const size_t end = std::min(begin + block_size_, size);
+                for (size_t j = begin; j < end; j++)
+                    if (std::abs(values[j] - written[j]) > threshold_)
+                    {
+                        changed[i].push_back(begin / block_size_);
+                        break;
+                    }
+            }
+            if (!changed[i].empty()) changed_entries++;
+        }
+        const uint32_t sequence = uint32_t(delta_paths_.size() + 1);
+        const std::string delta_path = path_ + ".delta" + std::to_string(sequence);
+        const std::string temporary_path = unique_temporary_path(delta_path);
+        try
+        {
+            {
+                std::ofstream stream(temporary_path, std::ios::out | std::ios::binary);
+                if (!stream.good()) throw IOException("Failed to open the file");
+                stream.write(delta_magic, sizeof(delta_magic));
+                ChecksumWriter writer(stream);
+                writer.write(delta_version);
+                writer.write(sequence);
+                writer.write(fingerprint_);
+                writer.write(uint64_t(block_size_));
+                writer.write(uint32_t(changed_entries));
+                for (size_t i = 0; i < count; i++)
+                {
+                    if (changed[i].empty()) continue;
+                    writer.write(uint32_t(i));
+                    writer.write(uint64_t(changed[i].size()));
+                    const size_t size = written_[i].size();
+                    for (const size_t block : changed[i])
+                    {
+                        const size_t begin = block * block_size_;
+                        const size_t length = std::min(block_size_, size - begin);
+                        writer.write(uint64_t(block));
+                        writer.write_bytes(entries[i].values + begin, length * sizeof(double));
+                    }
+                }
+                const uint32_t checksum = writer.checksum();
+                stream.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+                stream.close();
+                if (stream.fail()) throw IOException("Failed to write the delta file");
+            }
+            std::error_code error;
+            std::filesystem::rename(temporary_path, delta_path, error);
+            if (error) throw IOException("Failed to replace the delta file");
+        }
+        catch (...)
+        {
+            std::error_code error;
+            std::filesystem::remove(temporary_path, error);
+            throw;
+        }
+        delta_paths_.push_back(delta_path);
+        // Only update the written state after the delta is safely on the disk
+        for (size_t i = 0; i < count; i++)
+        {
+            const size_t size = written_[i].size();
+            double* written = &written_[i][0];
+            for (const size_t block : changed[i])
+            {
+                const size_t begin = block * block_size_;
+                const size_t end = std::min(begin + block_size_, size);
+                std::copy(entries[i].values + begin, entries[i].values + end, written + begin);
+            }
+        }
+    }
+
+    void DeltaCheckpointWriter::compact()
+    {
+        if (names_.empty()) throw IllegalOperationException("There is no checkpoint to compact");
+        std::vector<CheckpointEntry> entries;
+        const size_t count = names_.size();
+        for (size_t i = 0; i < count; i++)
+            entries.push_back({ names_[i], written_[i].shape(), written_[i].data().data() });
+        // The written values are exactly the state reconstructed from the chain
+        fingerprint_ = write_checkpoint(path_, entries);
+        remove_deltas();
+    }
+
+    std::vector<std::pair<std::string, Array<double>>> read_checkpoint_chain(const std::string& base_path,
+        const std::vector<std::string>& delta_paths)
+    {
+        std::vector<std::pair<std::string, Array<double>>> result;
+        uint32_t fingerprint;
+        {
+            const Checkpoint base(base_path);
+            fingerprint = base.fingerprint();
+            for (const std::string& name : base.names()) result.emplace_back(name, base.read(name));
+        }
+        for (size_t i = 0; i < delta_paths.size(); i++)
+        {
+            // Deltas are small, so read the whole file and check it before applying anything
+            std::ifstream stream(delta_paths[i], std::ios::in | std::ios::binary | std::ios::ate);
+            if (!stream.good()) throw IOException("Failed to open the file");
+            std::vector<char> bytes(size_t(stream.tellg()));
+            stream.seekg(0);
+            stream.read(bytes.data(), std::streamsize(bytes.size()));
+            if (!stream.good()) throw IOException("Failed to read the delta file");
+            constexpr size_t checksum_size = sizeof(uint32_t);
+            if (bytes.size() < sizeof(delta_magic) + checksum_size
+                || std::memcmp(bytes.data(), delta_magic, sizeof(delta_magic)) != 0)
+                throw IOException("The file is not a delta file");
+            const size_t body_size = bytes.size() - sizeof(delta_magic) - checksum_size;
+            uint32_t checksum;
+            std::memcpy(&checksum, bytes.data() + bytes.size() - checksum_size, checksum_size);
+            if (crc32(bytes.data() + sizeof(delta_magic), body_size) != checksum)
+                throw IOException("The delta file is corrupted");
+            ByteReader reader(bytes.data() + sizeof(delta_magic), body_size);
+            if (reader.read<uint32_t>() != delta_version) throw IOException("Unsupported delta version");
+            if (reader.read<uint32_t>() != i + 1) throw IOException("Delta files are not in the order of the chain");
+            if (reader.read<uint32_t>() != fingerprint)
+                throw IOException("The delta file doesn't belong to the base checkpoint");
+            const size_t block_size = size_t(reader.read<uint64_t>());
+            const size_t changed_entries = reader.read<uint32_t>();
+            for (size_t j = 0; j < changed_entries; j++)
+            {
+                const size_t index = reader.read<uint32_t>();
+                if (index >= result.size()) throw IOException("The delta file is invalid");
+                Array<double>& values = result[index].second;
+                const size_t size = values.size();
+                const size_t block_count = size_t(reader.read<uint64_t>());
+                for (size_t k = 0; k < block_count; k++)
+                {
+                    const size_t begin = size_t(reader.read<uint64_t>()) * block_size;
+                    if (begin >= size) throw IOException("The delta file is invalid");
+                    reader.read_bytes(&values[begin], std::min(block_size, size - begin) * sizeof(double));
+                }
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "checkpoint.h"
+
+namespace chloro
+{
+    /**
+     * \brief Writes a chain of checkpoints, consisting of a full base checkpoint followed by deltas which only
+     * contain the blocks of the arrays that changed since the previous checkpoint in the chain.
+     * \details The base checkpoint is written to \a path with \c write_checkpoint, and the deltas are written
+     * to \a path followed by ".delta" and their sequence numbers. A block is written into a delta if any of
+     * its values differ from the last written ones by more than the threshold. The writer keeps a copy of the
+     * last written values (the state reconstructed by loading the chain) for comparison, so small changes are
+     * accumulated until they exceed the threshold instead of being lost.
+     */
+    class DeltaCheckpointWriter final
+    {
+    private:
+        std::string path_;
+        double threshold_;
+        size_t block_size_;
+        size_t full_interval_;
+        uint32_t fingerprint_ = 0;
+        std::vector<std::string> names_;
+        std::vector<Array<double>> written_;
+        std::vector<std::string> delta_paths_;
+        void remove_deltas();
+    public:
+        /**
+         * \brief Constructs a writer, no files are written until \c write is called.
+         * \param path The full path or relative path to the base checkpoint file.
+         * \param threshold Maximum absolute change of a value that is not considered a change.
+         * \param block_size Amount of values in a block, the unit of changes written into deltas.
+         * \param full_interval Amount of deltas written by \c write before a new full checkpoint is written.
+         */
+        explicit DeltaCheckpointWriter(std::string path, double threshold = 0.0, size_t block_size = 4096,
+            size_t full_interval = 16);
+        /**
+         * \brief Write a delta checkpoint, or a full one if there is no base checkpoint yet or enough deltas
+         * have been chained to the current base.
+         * \param entries The arrays to write, which should be the same as the ones in the base checkpoint
+         * except for their values.
+         */
+        void write(const std::vector<CheckpointEntry>& entries);
+        /**
+         * \brief Write a full checkpoint as the new base of the chain, and remove the deltas of the old base.
+         * \param entries The arrays to write.
+         */
+        void write_full(const std::vector<CheckpointEntry>& entries);
+        /**
+         * \brief Write a delta checkpoint containing the changed blocks.
+         * \param entries The arrays to write, which should be the same as the ones in the base checkpoint
+         * except for their values.
+         */
+        void write_delta(const std::vector<CheckpointEntry>& entries);
+        /** \brief Merge the base checkpoint and all the deltas into a new base checkpoint. */
+        void compact();
+        /** \brief Get the path to the base checkpoint file. */
+        const std::string& base_path() const { return path_; }
+        /** \brief Get the paths to the delta files chained to the current base, in order. */
+        const std::vector<std::string>& delta_paths() const { return delta_paths_; }
+    };
+
+    /**
+     * \brief Reconstruct the arrays stored in a chain of checkpoints.
+     * \details The base checkpoint and the deltas are read in a single sequential pass, every delta is checked
+     * against its checksum and its position in the chain before its values are used.
+     * \param base_path The full path or relative path to the base checkpoint file.
+     * \param delta_paths Paths to the delta files in the order they were written.
+     * \return Names and values of the arrays, in the order of the base checkpoint.
+     */
+    std::vector<std::pair<std::string, Array<double>>> read_checkpoint_chain(const std::string& base_path,
+        const std::vector<std::string>& delta_paths);
+}
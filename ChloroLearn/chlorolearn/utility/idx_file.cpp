@@ -0,0 +1,92 @@
+#include "idx_file.h"
+#include "binary_io.h"
+
+namespace chloro
+{
+    namespace
+    {
+        constexpr uint8_t unsigned_byte_type = 0x08;
+
+        uint32_t read_big_endian(const uint8_t* data)
+        {
+            return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | uint32_t(data[3]);
+        }
+    }
+
+    IdxFile::IdxFile(const std::string& path) :map_(path)
+    {
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(map_.data());
+        const size_t file_size = map_.size();
+        if (file_size < 4 || header[0] != 0 || header[1] != 0) throw IOException("The file is not an IDX file");
+        if (header[2] != unsigned_byte_type) throw IOException("Only IDX files of unsigned bytes are supported");
+        const size_t dimension = header[3];
+        if (dimension == 0) throw IOException("The IDX file has no dimensions");
+        // The first dimension is the sample count, the rest are the shape of the samples
+        if (dimension - 1 > ArrayShape::max_dimension) throw IOException("The IDX file has too many dimensions");
+        const size_t offset = 4 + 4 * dimension;
+        if (file_size < offset) throw IOException("The IDX file is truncated");
+        size_ = read_big_endian(header + 4);
+        for (size_t i = 1; i < dimension; i++)
+        {
+            shape_.push_back(read_big_endian(header + 4 + 4 * i));
+            sample_size_ = checked_multiply(sample_size_, shape_.back(), "The IDX file is invalid");
+        }
+        if (shape_.empty()) shape_ = { 1 };
+        if (sample_size_ != 0 && size_ > (file_size - offset) / sample_size_)
+            throw IOException("The IDX file is truncated");
+        values_ = reinterpret_cast<uint8_t*>(map_.data() + offset);
+    }
+
+    const uint8_t* IdxFile::sample_data(const size_t index) const
+    {
+        if (index >= size_) throw ArgumentOutOfRangeException("Sample index out of range");
+        return values_ + index * sample_size_;
+    }
+
+    Array<uint8_t> IdxFile::sample(const size_t index) const
+    {
+        if (index >= size_) throw ArgumentOutOfRangeException("Sample index out of range");
+        return Array<uint8_t>::view(values_ + index * sample_size_, shape_);
+    }
+
+    IdxDataSource::IdxDataSource(const std::vector<IdxField>& fields) :fields_(fields)
+    {
+        if (fields_.empty()) throw IllegalArgumentException("There should be at least one IDX file");
+        for (const IdxField& field : fields_)
+        {
+            files_.emplace_back(field.path);
+            const IdxFile& file = files_.back();
+            if (file.size() != files_[0].size())
+                throw MismatchedSizesException("IDX files should contain the same amount of samples");
+            if (field.classes == 0)
+                shapes_.push_back(file.shape());
+            else if (file.sample_size() == 1)
+                shapes_.push_back({ field.classes });
+            else
+                throw IllegalArgumentException("Only scalar values can be converted into one-hot vectors");
+        }
+        if (files_[0].size() == 0) throw IllegalArgumentException("IDX files should not be empty");
+    }
+
+    void IdxDataSource::fetch(const size_t index, const size_t field, Array<double>& out) const
+    {
+        const IdxFile& file = files_[field];
+        const IdxField& description = fields_[field];
+        const ArrayShape& shape = shapes_[field];
+        const uint8_t* values = file.sample_data(index);
+        if (out.shape() != shape || out.is_view()) out = Array<double>::zeros(shape);
+        double* const result = &out[0];
+        if (description.classes == 0)
+        {
+            const size_t size = file.sample_size();
+            const double scale = description.scale;
+            for (size_t i = 0; i < size; i++) result[i] = values[i] * scale;
+        }
+        else
+        {
+            if (values[0] >= description.classes) throw ArgumentOutOfRangeException("Class index out of range");
+            std::fill(result, result + description.classes, 0.0);
+            result[values[0]] = description.scale;
+        }
+    }
+}
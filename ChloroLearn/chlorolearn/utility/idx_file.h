@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../basic/array.h"
+#include "memory_map.h"
+#include "data_source.h"
+
+namespace chloro
+{
+    /**
+     * \brief A memory mapped file of the IDX format, which is used by datasets like MNIST.
+     * \details The first dimension of the file indexes the samples, the rest of them form the shape of every
+     * sample. Only files of unsigned bytes are supported. Samples are views of the mapped memory, so opening
+     * a file takes no time regardless of its size.
+     */
+    class IdxFile final
+    {
+    private:
+        MemoryMap map_;
+        uint8_t* values_ = nullptr;
+        size_t size_ = 0;
+        ArrayShape shape_;
+        size_t sample_size_ = 1;
+    public:
+        /**
+         * \brief Map an IDX file and read its header.
+         * \param path The full path or relative path to the file.
+         */
+        explicit IdxFile(const std::string& path);
+        /** \brief Get the amount of samples in the file. */
+        size_t size() const { return size_; }
+        /** \brief Get the shape of every sample, { 1 } for files of scalars like labels. */
+        const ArrayShape& shape() const { return shape_; }
+        /** \brief Get the amount of values in every sample. */
+        size_t sample_size() const { return sample_size_; }
+        /** \brief Get a pointer to the first value of a sample in the mapped memory. */
+        const uint8_t* sample_data(size_t index) const;
+        /** \brief Get a sample as a view of the mapped memory. */
+        Array<uint8_t> sample(size_t index) const;
+    };
+
+    /** \brief Describes how an IDX file is converted into a field of an \c IdxDataSource. */
+    struct IdxField final
+    {
+        std::string path; /**< \brief Path to the IDX file. */
+        double scale = 1.0; /**< \brief Factor multiplied to the values, like 1/255 for pixels. */
+        /**
+         * \brief If positive, scalar values of the file are class indices, which are converted
+         * into one-hot vectors of this length.
+         */
+        size_t classes = 0;
+    };
+
+    /**
+     * \brief A data source over memory mapped IDX files, every file is a field of the samples.
+     * \details Samples are converted from unsigned bytes into doubles when they are fetched, so only the
+     * compact byte data stays in memory (or in the page cache).
+     */
+    class IdxDataSource final : public DataSource
+    {
+    private:
+        std::vector<IdxFile> files_;
+        std::vector<IdxField> fields_;
+        std::vector<ArrayShape> shapes_;
+    public:
+        /**
+         * \brief Map some IDX files, which should contain the same amount of samples.
+         * \param fields Descriptions of the fields, for example the images and the labels of MNIST.
+         */
+        explicit IdxDataSource(const std::vector<IdxField>& fields);
+        size_t size() const override { return files_[0].size(); } /**< \copydoc DataSource::size */
+        size_t field_count() const override { return files_.size(); } /**< \copydoc DataSource::field_count */
+        /** \copydoc DataSource::shape */
+        const ArrayShape& shape(const size_t field) const override { return shapes_[field]; }
+        /** \brief Convert a field of a sample into an array of doubles. */
+        void fetch(size_t index, size_t field, Array<double>& out) const override;
+    };
+}
@@ -0,0 +1,108 @@
+#include <utility>
+
+#include "memory_map.h"
+#include "../basic/exceptions.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace chloro
+{
+    MemoryMap::MemoryMap(const std::string& path)
+    {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            file_ = nullptr;
+            throw IOException("Failed to open the file");
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size))
+        {
+            close();
+            throw IOException("Failed to get the size of the file");
+        }
+        size_ = size_t(size.QuadPart);
+        if (size_ == 0) return;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (mapping_ != nullptr) data_ = static_cast<char*>(MapViewOfFile(mapping_, FILE_MAP_COPY, 0, 0, 0));
+        if (data_ == nullptr)
+        {
+            close();
+            throw IOException("Failed to map the file into memory");
+        }
+#else
+        const int file = ::open(path.c_str(), O_RDONLY);
+        if (file == -1) throw IOException("Failed to open the file");
+        struct stat status {};
+        if (::fstat(file, &status) == -1)
+        {
+            ::close(file);
+            throw IOException("Failed to get the size of the file");
+        }
+        size_ = size_t(status.st_size);
+        if (size_ == 0)
+        {
+            ::close(file);
+            return;
+        }
+        void* data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        ::close(file);
+        if (data == MAP_FAILED)
+        {
+            size_ = 0;
+            throw IOException("Failed to map the file into memory");
+        }
+        data_ = static_cast<char*>(data);
+#endif
+    }
+
+    MemoryMap::MemoryMap(MemoryMap&& other) noexcept :
+        data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0))
+#ifdef _WIN32
+        , file_(std::exchange(other.file_, nullptr)),
+        mapping_(std::exchange(other.mapping_, nullptr))
+#endif
+    {}
+
+    MemoryMap& MemoryMap::operator=(MemoryMap&& other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+            file_ = std::exchange(other.file_, nullptr);
+            mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+    void MemoryMap::close() noexcept
+    {
+#ifdef _WIN32
+        if (data_ != nullptr) UnmapViewOfFile(data_);
+        if (mapping_ != nullptr) CloseHandle(mapping_);
+        if (file_ != nullptr) CloseHandle(file_);
+        file_ = nullptr;
+        mapping_ = nullptr;
+#else
+        if (data_ != nullptr) ::munmap(data_, size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
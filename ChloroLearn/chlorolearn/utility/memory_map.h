@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+
+namespace chloro
+{
+    /**
+     * \brief A read only memory mapping of a whole file.
+     * \details The mapping is private and copy-on-write, so the mapped memory can be viewed by arrays
+     * directly, and writes to it (if any) never reach the file.
+     */
+    class MemoryMap final
+    {
+    private:
+        char* data_ = nullptr;
+        size_t size_ = 0;
+#ifdef _WIN32
+        void* file_ = nullptr;
+        void* mapping_ = nullptr;
+#endif
+        void close() noexcept;
+    public:
+        /** \brief Constructs an empty mapping. */
+        MemoryMap() = default;
+        /**
+         * \brief Map a file into memory.
+         * \param path The full path or relative path to the file.
+         */
+        explicit MemoryMap(const std::string& path);
+        MemoryMap(const MemoryMap&) = delete;
+        MemoryMap& operator=(const MemoryMap&) = delete;
+        MemoryMap(MemoryMap&& other) noexcept; /**< \brief Move constructor. */
+        MemoryMap& operator=(MemoryMap&& other) noexcept; /**< \brief Move assignment operator. */
+        ~MemoryMap() noexcept { close(); } /**< \brief Unmaps the file. */
+        /** \brief Get a pointer to the first byte of the mapped file. */
+        char* data() const { return data_; }
+        /** \brief Get the size of the mapped file in bytes. */
+        size_t size() const { return size_; }
+    };
+}
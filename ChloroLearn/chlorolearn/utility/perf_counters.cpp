@@ -0,0 +1,101 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+namespace chloro
+{
+#ifdef __linux__
+    namespace
+    {
+        const uint64_t events[perf_counter_count] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+        int open_counter(const uint64_t event)
+        {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.size = sizeof(attributes);
+            attributes.config = event;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.inherit = 1;
+            attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            // There's no glibc wrapper of perf_event_open
+            return int(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+        }
+    }
+
+    PerfCounters::PerfCounters()
+    {
+        for (size_t i = 0; i < perf_counter_count; i++) descriptors_[i] = open_counter(events[i]);
+    }
+
+    PerfCounters::~PerfCounters() noexcept
+    {
+        for (const int descriptor : descriptors_)
+            if (descriptor >= 0) close(descriptor);
+    }
+
+    PerfSamples PerfCounters::sample() const
+    {
+        PerfSamples samples{};
+        for (size_t i = 0; i < perf_counter_count; i++)
+        {
+            uint64_t values[3]; // Value, time enabled, time running
+            if (descriptors_[i] < 0 || ::read(descriptors_[i], values, sizeof(values)) != ssize_t(sizeof(values)))
+                continue;
+            samples[i] = { values[0], values[1], values[2] };
+        }
+        return samples;
+    }
+#else
+    PerfCounters::PerfCounters() = default;
+
+    PerfCounters::~PerfCounters() noexcept = default;
+
+    PerfSamples PerfCounters::sample() const { return {}; }
+#endif
+
+    namespace
+    {
+        uint64_t scale(const uint64_t value, const uint64_t time_enabled, const uint64_t time_running)
+        {
+            return time_running == 0 || time_running >= time_enabled ? value
+                : uint64_t(double(value) * double(time_enabled) / double(time_running));
+        }
+
+        uint64_t increase(const uint64_t start, const uint64_t end) { return end > start ? end - start : 0; }
+    }
+
+    PerfReading PerfCounters::read() const
+    {
+        const PerfSamples samples = sample();
+        PerfReading reading{};
+        for (size_t i = 0; i < perf_counter_count; i++)
+            reading[i] = scale(samples[i].value, samples[i].time_enabled, samples[i].time_running);
+        return reading;
+    }
+
+    PerfReading PerfCounters::difference(const PerfSamples& start, const PerfSamples& end)
+    {
+        PerfReading reading{};
+        for (size_t i = 0; i < perf_counter_count; i++)
+            reading[i] = scale(increase(start[i].value, end[i].value),
+                increase(start[i].time_enabled, end[i].time_enabled),
+                increase(start[i].time_running, end[i].time_running));
+        return reading;
+    }
+
+    bool PerfCounters::available() const
+    {
+        for (const int descriptor : descriptors_)
+            if (descriptor >= 0) return true;
+        return false;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace chloro
+{
+    /** \brief Hardware events counted by \c PerfCounters. */
+    enum class PerfCounter : size_t
+    {
+        cycles, /**< \brief CPU cycles. */
+        instructions, /**< \brief Retired instructions. */
+        cache_misses, /**< \brief Misses of the last level cache. */
+        branch_misses /**< \brief Mispredicted branches. */
+    };
+
+    /** \brief Amount of the counted hardware events. */
+    constexpr size_t perf_counter_count = 4;
+
+    /** \brief Values of the hardware event counters, indexed by \c PerfCounter. */
+    using PerfReading = std::array<uint64_t, perf_counter_count>;
+
+    /** \brief An unscaled value of a counter, with the nanoseconds it was enabled and actually counting. */
+    struct PerfSample final
+    {
+        uint64_t value = 0; /**< \brief Counted events. */
+        uint64_t time_enabled = 0; /**< \brief Time the counter was enabled. */
+        uint64_t time_running = 0; /**< \brief Time the counter was counting, less than enabled if multiplexed. */
+    };
+
+    /** \brief Unscaled values of the hardware event counters, indexed by \c PerfCounter. */
+    using PerfSamples = std::array<PerfSample, perf_counter_count>;
+
+    /**
+     * \brief Hardware performance counters of the current process, read through \c perf_event_open on Linux.
+     * \details Only user space events are counted. The counters are inherited by threads created after they
+     * are opened, but the counts of such threads are only added when they exit, so the chunks the worker
+     * threads of the parallel kernels process are not counted, as the workers are kept alive between the
+     * kernels. Set the thread count to 1 for counting whole kernels.
+     * \details Counters may be unavailable, for example on other platforms, in containers without the
+     * permission to use them, or on virtual machines without a PMU. Unavailable counters always read 0, and
+     * opening never fails.
+     */
+    class PerfCounters final
+    {
+    private:
+        std::array<int, perf_counter_count> descriptors_{ -1, -1, -1, -1 };
+    public:
+        /** \brief Open the counters which are available. */
+        PerfCounters();
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+        ~PerfCounters() noexcept; /**< \brief Close the counters. */
+        /** \brief Check whether any counter is available. */
+        bool available() const;
+        /** \brief Check whether a counter is available. */
+        bool available(const PerfCounter counter) const { return descriptors_[size_t(counter)] >= 0; }
+        /**
+         * \brief Read the current values of the counters.
+         * \details Counters which were multiplexed with other events are scaled up by the fraction of the
+         * time they were actually counting.
+         */
+        PerfReading read() const;
+        /** \brief Read the current values of the counters without scaling them, see \c difference. */
+        PerfSamples sample() const;
+        /**
+         * \brief Get the events counted between two samples.
+         * \details The differences are scaled by the fraction of the time between the samples the counters were
+         * actually counting. Scaled values aren't monotonic, so differences of them could be negative.
+         */
+        static PerfReading difference(const PerfSamples& start, const PerfSamples& end);
+    };
+}
@@ -0,0 +1,316 @@
+#include <cmath>
+#include <cstring>
+
+#include "precision.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHLORO_X86_KERNELS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CHLORO_AVX2_TARGET
+#else
+#define CHLORO_AVX2_TARGET __attribute__((target("avx2,f16c")))
+#endif
+#endif
+
+namespace chloro
+{
+    namespace
+    {
+        uint32_t float_bits(const float value)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        float bits_float(const uint32_t bits)
+        {
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        uint16_t float_to_half(const float value)
+        {
+            uint32_t bits = float_bits(value);
+            const uint16_t sign = uint16_t(bits >> 16 & 0x8000);
+            bits &= 0x7FFFFFFF;
+            // Quiet NaNs keep the top of their payload, like the conversion instruction does
+            if (bits > 0x7F800000) return sign | uint16_t(0x7E00 | (bits >> 13 & 0x3FF));
+            if (bits == 0x7F800000) return sign | 0x7C00;
+            if (bits >= 0x477FF000) return sign | 0x7C00; // Rounds to infinity
+            if (bits < 0x38800000) // Subnormal half, let the floating point addition do the rounding
+                return sign | uint16_t(float_bits(bits_float(bits) + 0.5f) - 0x3F000000);
+            // Rebias the exponent and round to nearest even
+            bits += 0xC8000FFF + (bits >> 13 & 1);
+            return sign | uint16_t(bits >> 13);
+        }
+
+        float half_to_float(const uint16_t value)
+        {
+            const uint32_t sign = uint32_t(value & 0x8000) << 16;
+            const uint32_t rest = value & 0x7FFF;
+            if (rest >= 0x7C00) return bits_float(sign | 0x7F800000 | (rest & 0x3FF) << 13); // NaN or infinity
+            if (rest >= 0x0400) return bits_float(sign | ((rest << 13) + 0x38000000));
+            return bits_float(sign | float_bits(float(rest) * 5.9604644775390625e-8f)); // Subnormal, times 2^-24
+        }
+
+        uint16_t float_to_bfloat(const float value)
+        {
+            const uint32_t bits = float_bits(value);
+            if ((bits & 0x7FFFFFFF) > 0x7F800000) return uint16_t(bits >> 16 | 0x40); // Keep NaNs quiet
+            return uint16_t((bits + 0x7FFF + (bits >> 16 & 1)) >> 16);
+        }
+
+        size_t channel_count(const ArrayShape& shape) { return shape.size() > 1 ? shape[0] : 1; }
+
+#ifdef CHLORO_X86_KERNELS
+        // The vector kernels need AVX2 and F16C, which are detected at run time, so that the default builds
+        // use them too, not only the builds targeting the building machine. They return how many values
+        // they converted, the rest is left to the scalar code, which gives the same results.
+        bool has_vector_kernels()
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) return false;
+            __cpuid(info, 1);
+            const bool avx_enabled = (info[2] >> 27 & 1) && (info[2] >> 28 & 1) && (_xgetbv(0) & 6) == 6;
+            if (!avx_enabled || !(info[2] >> 29 & 1)) return false;
+            __cpuidex(info, 7, 0);
+            return info[1] >> 5 & 1;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+#endif
+        }
+
+        const bool vector_kernels = has_vector_kernels();
+
+        CHLORO_AVX2_TARGET __m256 load_floats(const double* values)
+        {
+            return _mm256_set_m128(_mm256_cvtpd_ps(_mm256_loadu_pd(values + 4)),
+                _mm256_cvtpd_ps(_mm256_loadu_pd(values)));
+        }
+
+        CHLORO_AVX2_TARGET void store_doubles(const __m256 floats, double* out)
+        {
+            _mm256_storeu_pd(out, _mm256_cvtps_pd(_mm256_castps256_ps128(floats)));
+            _mm256_storeu_pd(out + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(floats, 1)));
+        }
+
+        CHLORO_AVX2_TARGET size_t to_float16_avx2(const double* values, uint16_t* out, const size_t size)
+        {
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                    _mm256_cvtps_ph(load_floats(values + i), _MM_FROUND_TO_NEAREST_INT));
+            return i;
+        }
+
+        CHLORO_AVX2_TARGET size_t from_float16_avx2(const uint16_t* values, double* out, const size_t size)
+        {
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+                store_doubles(_mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i))), out + i);
+            return i;
+        }
+
+        CHLORO_AVX2_TARGET size_t to_bfloat16_avx2(const double* values, uint16_t* out, const size_t size)
+        {
+            const __m256i magnitude = _mm256_set1_epi32(0x7FFFFFFF);
+            const __m256i infinity = _mm256_set1_epi32(0x7F800000);
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                const __m256i bits = _mm256_castps_si256(load_floats(values + i));
+                const __m256i lowest = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+                const __m256i rounded = _mm256_srli_epi32(
+                    _mm256_add_epi32(_mm256_add_epi32(bits, _mm256_set1_epi32(0x7FFF)), lowest), 16);
+                const __m256i quiet = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x40));
+                const __m256i nan = _mm256_cmpgt_epi32(_mm256_and_si256(bits, magnitude), infinity);
+                const __m256i result = _mm256_blendv_epi8(rounded, quiet, nan);
+                // Packing works within the 128-bit lanes, gather the low halves of both lanes
+                const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(result, result), 0x08);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(packed));
+            }
+            return i;
+        }
+
+        CHLORO_AVX2_TARGET size_t from_bfloat16_avx2(const uint16_t* values, double* out, const size_t size)
+        {
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                const __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+                const __m256i bits = _mm256_cvtepu16_epi32(halves);
+                store_doubles(_mm256_castsi256_ps(_mm256_slli_epi32(bits, 16)), out + i);
+            }
+            return i;
+        }
+
+        // Maximum absolute value, ignoring NaNs like std::max does
+        CHLORO_AVX2_TARGET size_t max_abs_avx2(const double* values, const size_t size, double& max)
+        {
+            const __m256d magnitude = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFF));
+            __m256d result = _mm256_set1_pd(max);
+            size_t i = 0;
+            // The maximum instruction returns the second operand if either is NaN
+            for (; i + 4 <= size; i += 4)
+                result = _mm256_max_pd(_mm256_and_pd(_mm256_loadu_pd(values + i), magnitude), result);
+            const __m128d half = _mm_max_pd(_mm256_castpd256_pd128(result), _mm256_extractf128_pd(result, 1));
+            max = std::max(_mm_cvtsd_f64(half), _mm_cvtsd_f64(_mm_unpackhi_pd(half, half)));
+            return i;
+        }
+
+        CHLORO_AVX2_TARGET size_t scale_int8_avx2(const int8_t* values, const double scale, double* out,
+            const size_t size)
+        {
+            const __m256d factor = _mm256_set1_pd(scale);
+            size_t i = 0;
+            for (; i + 4 <= size; i += 4)
+            {
+                int32_t bytes;
+                std::memcpy(&bytes, values + i, sizeof(bytes));
+                const __m256d converted = _mm256_cvtepi32_pd(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(bytes)));
+                _mm256_storeu_pd(out + i, _mm256_mul_pd(converted, factor));
+            }
+            return i;
+        }
+#endif
+    }
+
+    size_t encoded_size(const Precision precision, const ArrayShape& shape)
+    {
+        const size_t size = shape.element_count();
+        switch (precision)
+        {
+        case Precision::float64: return size * sizeof(double);
+        case Precision::float16:
+        case Precision::bfloat16: return size * sizeof(uint16_t);
+        case Precision::int8: return channel_count(shape) * sizeof(float) + size;
+        }
+        throw IllegalArgumentException("Unknown precision");
+    }
+
+    void to_float16(const double* values, uint16_t* out, const size_t size)
+    {
+        size_t i = 0;
+#ifdef CHLORO_X86_KERNELS
+        if (vector_kernels) i = to_float16_avx2(values, out, size);
+#endif
+        for (; i < size; i++) out[i] = float_to_half(float(values[i]));
+    }
+
+    void from_float16(const uint16_t* values, double* out, const size_t size)
+    {
+        size_t i = 0;
+#ifdef CHLORO_X86_KERNELS
+        if (vector_kernels) i = from_float16_avx2(values, out, size);
+#endif
+        for (; i < size; i++) out[i] = half_to_float(values[i]);
+    }
+
+    void to_bfloat16(const double* values, uint16_t* out, const size_t size)
+    {
+        size_t i = 0;
+#ifdef CHLORO_X86_KERNELS
+        if (vector_kernels) i = to_bfloat16_avx2(values, out, size);
+#endif
+        for (; i < size; i++) out[i] = float_to_bfloat(float(values[i]));
+    }
+
+    void from_bfloat16(const uint16_t* values, double* out, const size_t size)
+    {
+        size_t i = 0;
+#ifdef CHLORO_X86_KERNELS
+        if (vector_kernels) i = from_bfloat16_avx2(values, out, size);
+#endif
+        for (; i < size; i++) out[i] = bits_float(uint32_t(values[i]) << 16);
+    }
+
+    void encode(const Precision precision, const double* values, const ArrayShape& shape, void* out)
+    {
+        const size_t size = shape.element_count();
+        switch (precision)
+        {
+        case Precision::float64:
+            std::memcpy(out, values, size * sizeof(double));
+            return;
+        case Precision::float16:
+            to_float16(values, static_cast<uint16_t*>(out), size);
+            return;
+        case Precision::bfloat16:
+            to_bfloat16(values, static_cast<uint16_t*>(out), size);
+            return;
+        case Precision::int8:
+        {
+            // Scales of the channels come first, followed by the quantized values
+            const size_t channels = channel_count(shape);
+            const size_t channel_size = size / channels;
+            char* bytes = static_cast<char*>(out);
+            int8_t* quantized = reinterpret_cast<int8_t*>(bytes + channels * sizeof(float));
+            for (size_t i = 0; i < channels; i++)
+            {
+                const double* channel = values + i * channel_size;
+                double max = 0.0;
+                size_t j = 0;
+#ifdef CHLORO_X86_KERNELS
+                if (vector_kernels) j = max_abs_avx2(channel, channel_size, max);
+#endif
+                for (; j < channel_size; j++) max = std::max(max, std::abs(channel[j]));
+                const float scale = float(max / 127);
+                std::memcpy(bytes + i * sizeof(float), &scale, sizeof(float));
+                const double inverse = scale > 0 ? 1 / double(scale) : 0.0;
+                for (size_t j = 0; j < channel_size; j++)
+                {
+                    const double rounded = std::round(channel[j] * inverse);
+                    quantized[i * channel_size + j] = int8_t(std::max(-127.0, std::min(127.0, rounded)));
+                }
+            }
+            return;
+        }
+        }
+        throw IllegalArgumentException("Unknown precision");
+    }
+
+    void decode(const Precision precision, const void* data, const ArrayShape& shape, double* out)
+    {
+        const size_t size = shape.element_count();
+        switch (precision)
+        {
+        case Precision::float64:
+            std::memcpy(out, data, size * sizeof(double));
+            return;
+        case Precision::float16:
+            from_float16(static_cast<const uint16_t*>(data), out, size);
+            return;
+        case Precision::bfloat16:
+            from_bfloat16(static_cast<const uint16_t*>(data), out, size);
+            return;
+        case Precision::int8:
+        {
+            const size_t channels = channel_count(shape);
+            const size_t channel_size = size / channels;
+            const char* bytes = static_cast<const char*>(data);
+            const int8_t* quantized = reinterpret_cast<const int8_t*>(bytes + channels * sizeof(float));
+            for (size_t i = 0; i < channels; i++)
+            {
+                float scale;
+                std::memcpy(&scale, bytes + i * sizeof(float), sizeof(float));
+                const int8_t* channel = quantized + i * channel_size;
+                double* values = out + i * channel_size;
+                size_t j = 0;
+#ifdef CHLORO_X86_KERNELS
+                if (vector_kernels) j = scale_int8_avx2(channel, double(scale), values, channel_size);
+#endif
+                for (; j < channel_size; j++) values[j] = channel[j] * double(scale);
+            }
+            return;
+        }
+        }
+        throw IllegalArgumentException("Unknown precision");
+    }
+}
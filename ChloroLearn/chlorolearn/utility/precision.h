@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "../basic/array.h"
+
+namespace chloro
+{
+    /**
+     * \brief Precisions of the values stored in checkpoint files.
+     * \details On x86-64 processors supporting AVX2 and F16C, which is checked at run time, the float16 and
+     * bfloat16 conversions and the int8 decoding use vector instructions, with the same results as the
+     * scalar code. Quantizing to int8 only vectorizes finding the scales.
+     */
+    enum class Precision : uint32_t
+    {
+        float64 = 0, /**< \brief IEEE 754 double precision, lossless. */
+        float16 = 1, /**< \brief IEEE 754 half precision, 11 significant bits and a range of about 65504. */
+        bfloat16 = 2, /**< \brief Brain floating point, 8 significant bits but the full range of float. */
+        /**
+         * \brief 8-bit integers with a float scale for every channel, that is every index of the first
+         * dimension of arrays of at least 2 dimensions, or a single scale for other arrays.
+         */
+        int8 = 3
+    };
+
+    /**
+     * \brief Get the amount of bytes needed to store an array in a precision.
+     * \param precision The precision.
+     * \param shape Shape of the array.
+     * \return The amount of bytes, including the scales of int8 arrays.
+     */
+    size_t encoded_size(Precision precision, const ArrayShape& shape);
+
+    /**
+     * \brief Convert an array into a precision.
+     * \param precision The precision.
+     * \param values Pointer to the values of the array.
+     * \param shape Shape of the array.
+     * \param out Pointer to the result, which should have room for \c encoded_size bytes.
+     */
+    void encode(Precision precision, const double* values, const ArrayShape& shape, void* out);
+
+    /**
+     * \brief Convert an array stored in a precision back into doubles.
+     * \param precision The precision.
+     * \param data Pointer to the stored array, as written by \c encode.
+     * \param shape Shape of the array.
+     * \param out Pointer to the result, which should have room for all the values of the array.
+     */
+    void decode(Precision precision, const void* data, const ArrayShape& shape, double* out);
+
+    /** \brief Convert values into half precision, rounding to nearest even. */
+    void to_float16(const double* values, uint16_t* out, size_t size);
+    /** \brief Convert values in half precision into doubles. */
+    void from_float16(const uint16_t* values, double* out, size_t size);
+    /** \brief Convert values into bfloat16, rounding to nearest even. */
+    void to_bfloat16(const double* values, uint16_t* out, size_t size);
+    /** \brief Convert values in bfloat16 into doubles. */
+    void from_bfloat16(const uint16_t* values, double* out, size_t size);
+}
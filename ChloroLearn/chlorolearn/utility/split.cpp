@@ -0,0 +1,169 @@
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+#include "split.h"
+
+namespace chloro
+{
+    namespace
+    {
+        // Fisher-Yates shuffle, since the algorithms of std::shuffle and std::uniform_int_distribution are
+        // left to the standard library, while the output of std::mt19937_64 is the same everywhere
+        void shuffle(std::vector<size_t>& values, std::mt19937_64& generator)
+        {
+            for (size_t i = values.size(); i > 1; i--)
+            {
+                // Rejecting the lowest 2^64 % i outputs leaves a multiple of i outputs, so the remainder is unbiased
+                const uint64_t bound = uint64_t(i);
+                const uint64_t threshold = (0 - bound) % bound;
+                uint64_t random;
+                do random = generator(); while (random < threshold);
+                std::swap(values[i - 1], values[size_t(random % bound)]);
+            }
+        }
+
+        std::vector<size_t> shuffled_indices(const size_t size, std::mt19937_64& generator)
+        {
+            std::vector<size_t> permutation(size);
+            for (size_t i = 0; i < size; i++) permutation[i] = i;
+            shuffle(permutation, generator);
+            return permutation;
+        }
+
+        // Shuffled sample indices of every class, in the order of the class indices
+        std::vector<std::vector<size_t>> shuffled_groups(const std::vector<size_t>& classes,
+            std::mt19937_64& generator)
+        {
+            if (classes.empty()) throw IllegalArgumentException("There should be at least one sample");
+            // Map the class indices to dense ones, so that sparse indices don't create empty groups
+            std::vector<size_t> distinct = classes;
+            std::sort(distinct.begin(), distinct.end());
+            distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+            std::vector<std::vector<size_t>> groups(distinct.size());
+            for (size_t i = 0; i < classes.size(); i++)
+                groups[size_t(std::lower_bound(distinct.begin(), distinct.end(), classes[i]) - distinct.begin())]
+                    .push_back(i);
+            for (std::vector<size_t>& group : groups) shuffle(group, generator);
+            return groups;
+        }
+
+        void check_ratio(const double train_ratio)
+        {
+            if (train_ratio < 0 || train_ratio > 1)
+                throw IllegalArgumentException("Training set ratio should be between 0 and 1");
+        }
+
+        void check_folds(const size_t size, const size_t folds)
+        {
+            if (folds < 2) throw IllegalArgumentException("There should be at least 2 folds");
+            if (folds > size) throw IllegalArgumentException("There should be no more folds than samples");
+        }
+
+        // Build the splits of every fold given the fold each sample belongs to
+        std::vector<IndexSplit> folds_to_splits(const std::vector<size_t>& sample_folds, const size_t folds)
+        {
+            std::vector<IndexSplit> splits(folds);
+            const size_t size = sample_folds.size();
+            for (IndexSplit& split : splits) split.train.reserve(size - size / folds);
+            for (size_t i = 0; i < size; i++)
+                for (size_t j = 0; j < folds; j++)
+                    (sample_folds[i] == j ? splits[j].test : splits[j].train).push_back(i);
+            return splits;
+        }
+
+        size_t class_of(const Array<double>& label)
+        {
+            if (label.size() == 1)
+            {
+                // Doubles can't represent every integer above 2^53, so such labels can't be told apart
+                const double value = label[0];
+                if (!std::isfinite(value) || value < 0 || value > 9007199254740992.0 || value != std::floor(value))
+                    throw IllegalArgumentException("Scalar labels should be non-negative integers");
+                return size_t(value);
+            }
+            const ArrayBuffer<double>& values = label.data();
+            return size_t(std::max_element(values.begin(), values.end()) - values.begin());
+        }
+    }
+
+    IndexSplit index_split(const size_t size, const double train_ratio, const uint64_t seed)
+    {
+        check_ratio(train_ratio);
+        std::mt19937_64 generator(seed);
+        IndexSplit split;
+        split.train = shuffled_indices(size, generator);
+        const size_t train_size = size_t(size * train_ratio);
+        split.test.assign(split.train.begin() + train_size, split.train.end());
+        split.train.resize(train_size);
+        return split;
+    }
+
+    IndexSplit stratified_split(const std::vector<size_t>& classes, const double train_ratio, const uint64_t seed)
+    {
+        check_ratio(train_ratio);
+        std::mt19937_64 generator(seed);
+        IndexSplit split;
+        for (const std::vector<size_t>& group : shuffled_groups(classes, generator))
+        {
+            const size_t train_size = size_t(group.size() * train_ratio + 0.5);
+            split.train.insert(split.train.end(), group.begin(), group.begin() + train_size);
+            split.test.insert(split.test.end(), group.begin() + train_size, group.end());
+        }
+        // Mix the classes, or the training set would be ordered by class
+        shuffle(split.train, generator);
+        shuffle(split.test, generator);
+        return split;
+    }
+
+    std::vector<IndexSplit> k_fold_split(const size_t size, const size_t folds, const uint64_t seed)
+    {
+        check_folds(size, folds);
+        std::mt19937_64 generator(seed);
+        const std::vector<size_t> permutation = shuffled_indices(size, generator);
+        std::vector<size_t> sample_folds(size);
+        for (size_t i = 0; i < size; i++) sample_folds[permutation[i]] = i * folds / size;
+        return folds_to_splits(sample_folds, folds);
+    }
+
+    std::vector<IndexSplit> stratified_k_fold_split(const std::vector<size_t>& classes, const size_t folds,
+        const uint64_t seed)
+    {
+        check_folds(classes.size(), folds);
+        std::mt19937_64 generator(seed);
+        std::vector<size_t> sample_folds(classes.size());
+        // Deal the samples of every class to the folds in turn, continuing from where the last class stopped
+        // so that the folds get similar sizes
+        size_t fold = 0;
+        for (const std::vector<size_t>& group : shuffled_groups(classes, generator))
+            for (const size_t index : group)
+            {
+                sample_folds[index] = fold;
+                fold = (fold + 1) % folds;
+            }
+        return folds_to_splits(sample_folds, folds);
+    }
+
+    std::vector<size_t> class_indices(const DataValues& labels)
+    {
+        std::vector<size_t> classes;
+        classes.reserve(labels.size());
+        for (const Array<double>& label : labels) classes.push_back(class_of(label));
+        return classes;
+    }
+
+    std::vector<size_t> class_indices(const DataSource& source, const size_t field)
+    {
+        if (field >= source.field_count()) throw ArgumentOutOfRangeException("Field index out of range");
+        const size_t size = source.size();
+        std::vector<size_t> classes;
+        classes.reserve(size);
+        Array<double> label;
+        for (size_t i = 0; i < size; i++)
+        {
+            source.fetch(i, field, label);
+            classes.push_back(class_of(label));
+        }
+        return classes;
+    }
+}
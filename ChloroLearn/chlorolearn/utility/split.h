@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "data_source.h"
+
+namespace chloro
+{
+    /**
+     * \brief Indices of the samples in the training set and the test set of a split.
+     * \details A split only stores indices, wrap them in <tt>DataSubset</tt>s to iterate the samples of
+     * a data source, like <tt>graph.optimize(target, DataSubset(source, split.train), inputs, optimizer,
+     * batch_size)</tt>, \a inputs being the \c Input nodes fed by the fields of the source.
+     * \details The splitting functions shuffle with their own Fisher-Yates shuffle driven by a
+     * \c std::mt19937_64, so the same seed results in the same split with every standard library.
+     */
+    struct IndexSplit final
+    {
+        std::vector<size_t> train; /**< \brief Indices of the training samples. */
+        std::vector<size_t> test; /**< \brief Indices of the test samples. */
+    };
+
+    /**
+     * \brief Randomly split some samples to training set and test set.
+     * \param size Amount of the samples.
+     * \param train_ratio The propotion of training set to the whole set of samples.
+     * \param seed Seed of the shuffling, the same seed always results in the same split.
+     * \return The result split.
+     */
+    IndexSplit index_split(size_t size, double train_ratio = 0.8, uint64_t seed = 0);
+
+    /**
+     * \brief Randomly split some samples to training set and test set, keeping the proportions of
+     * the classes in both sets.
+     * \param classes Class index of every sample.
+     * \param train_ratio The propotion of training set to the samples of every class.
+     * \param seed Seed of the shuffling, the same seed always results in the same split.
+     * \return The result split.
+     */
+    IndexSplit stratified_split(const std::vector<size_t>& classes, double train_ratio = 0.8, uint64_t seed = 0);
+
+    /**
+     * \brief Randomly partition some samples into \a folds folds for cross validation.
+     * \param size Amount of the samples.
+     * \param folds Amount of the folds, should be at least 2 and at most \a size.
+     * \param seed Seed of the shuffling, the same seed always results in the same folds.
+     * \return One split for every fold, of which the test set is the fold and the training set is the rest.
+     */
+    std::vector<IndexSplit> k_fold_split(size_t size, size_t folds, uint64_t seed = 0);
+
+    /**
+     * \brief Randomly partition some samples into \a folds folds for cross validation, keeping the
+     * proportions of the classes in every fold.
+     * \param classes Class index of every sample.
+     * \param folds Amount of the folds, should be at least 2 and at most the amount of samples.
+     * \param seed Seed of the shuffling, the same seed always results in the same folds.
+     * \return One split for every fold, of which the test set is the fold and the training set is the rest.
+     */
+    std::vector<IndexSplit> stratified_k_fold_split(const std::vector<size_t>& classes, size_t folds,
+        uint64_t seed = 0);
+
+    /**
+     * \brief Get the class indices of some labels for stratified splits.
+     * \details Scalar labels are treated as class indices, which should be non-negative integers, other
+     * labels are treated as one-hot vectors (or class probabilities), whose class is that of the maximum value.
+     * \param labels The labels.
+     * \return Class index of every label.
+     */
+    std::vector<size_t> class_indices(const DataValues& labels);
+
+    /**
+     * \brief Get the class indices of a label field of a data source for stratified splits.
+     * \param source The data source.
+     * \param field Index of the label field.
+     * \return Class index of every sample.
+     * \see class_indices(const DataValues&)
+     */
+    std::vector<size_t> class_indices(const DataSource& source, size_t field);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "chlorolearn/basic/exceptions.h"
+#include "chlorolearn/basic/parallel.h"
+
+namespace chloro::benchmark
+{
+    /** \brief Timing of a benchmarked case. */
+    struct Result final
+    {
+        std::string name; /**< \brief Name of the case. */
+        std::string shape; /**< \brief Description of the problem size. */
+        size_t threads = 0; /**< \brief Amount of threads of the parallel kernels. */
+        size_t iterations = 0; /**< \brief Total amount of timed calls. */
+        double seconds = 0.0; /**< \brief Median time per call. */
+        double flops = 0.0; /**< \brief Floating point operations per call. */
+        double bytes = 0.0; /**< \brief Bytes read and written per call. */
+    };
+
+    /** \brief Command line options shared by the benchmarks. */
+    struct Options final
+    {
+        std::string json_path; /**< \brief Path of the JSON output, empty for none. */
+        std::string filter; /**< \brief Only cases whose names contain this are run. */
+        double min_time = 0.2; /**< \brief Minimum timed seconds per case. */
+        std::vector<size_t> threads{ 0 }; /**< \brief Thread counts to run the cases with, 0 for all the cores. */
+        std::vector<std::string> rest; /**< \brief Arguments not understood, left to the benchmark. */
+
+        /**
+         * \brief Parse the options, <tt>--json PATH --filter TEXT --min-time SECONDS --threads N[,N...]</tt>.
+         * \details Every benchmark runs all its cases once per thread count.
+         */
+        static Options parse(const int argc, char** argv)
+        {
+            Options options;
+            for (int i = 1; i < argc; i++)
+            {
+                const std::string argument = argv[i];
+                const bool has_value = i + 1 < argc;
+                if (argument == "--json" && has_value) options.json_path = argv[++i];
+                else if (argument == "--filter" && has_value) options.filter = argv[++i];
+                else if (argument == "--min-time" && has_value) options.min_time = std::atof(argv[++i]);
+                else if (argument == "--threads" && has_value) options.threads = parse_list(argv[++i]);
+                else options.rest.push_back(argument);
+            }
+            if (options.threads.empty()) throw IllegalArgumentException("At least one thread count is needed");
+            return options;
+        }
+
+        /** \brief Parse a comma separated list of counts. */
+        static std::vector<size_t> parse_list(const char* text)
+        {
+            std::vector<size_t> result;
+            while (*text != '\0')
+            {
+                char* end = nullptr;
+                result.push_back(size_t(std::strtoull(text, &end, 10)));
+                if (end == text) throw IllegalArgumentException("Expected a comma separated list of counts");
+                text = *end == ',' ? end + 1 : end;
+            }
+            return result;
+        }
+
+        /** \brief Check whether a case is selected by the filter. */
+        bool selected(const std::string& name) const
+        {
+            return filter.empty() || name.find(filter) != std::string::npos;
+        }
+    };
+
+    /** \brief Prevent the compiler from optimizing away a computed value. */
+    template <typename T>
+    void keep(const T& value)
+    {
+        static volatile const void* sink;
+        sink = &value;
+    }
+
+    /**
+     * \brief Time a function, taking the median of several samples after a warm-up call.
+     * \details Every sample runs the function enough times to take about a twentieth of the minimum time, so
+     * that fast functions aren't dominated by the resolution of the clock.
+     */
+    template <typename Func>
+    Result measure(std::string name, std::string shape, const double flops, const double bytes,
+        const double min_time, Func&& func)
+    {
+        using Clock = std::chrono::steady_clock;
+        func();
+        size_t batch = 1;
+        while (true)
+        {
+            const Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < batch; i++) func();
+            const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            if (elapsed >= min_time / 20 || batch >= (size_t(1) << 30)) break;
+            batch *= 2;
+        }
+        std::vector<double> samples;
+        double total = 0.0;
+        while (samples.size() < 5 || total < min_time)
+        {
+            const Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < batch; i++) func();
+            const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            samples.push_back(elapsed / double(batch));
+            total += elapsed;
+        }
+        std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        return { std::move(name), std::move(shape), thread_count(), samples.size() * batch, samples[samples.size() / 2],
+            flops, bytes };
+    }
+
+    /** \brief Write a row of the result table, or the header if \a result is null. */
+    inline void write_row(std::ostream& stream, const Result* result)
+    {
+        char line[256];
+        if (!result)
+            std::snprintf(line, sizeof(line), "%-44s %-24s %7s %12s %10s %10s\n", "name", "shape", "threads", "time us", "GFLOP/s", "GB/s");
+        else
+            std::snprintf(line, sizeof(line), "%-44.44s %-24.24s %7zu %12.3f %10.3f %10.3f\n", result->name.c_str(),
+                result->shape.c_str(), result->threads, result->seconds * 1e6, result->flops / result->seconds / 1e9,
+                result->bytes / result->seconds / 1e9);
+        stream << line << std::flush;
+    }
+
+    /** \brief Write a string as a JSON string literal. */
+    inline void write_json_string(std::ostream& stream, const std::string& value)
+    {
+        stream << '"';
+        for (const char c : value)
+        {
+            if (c == '"' || c == '\\') stream << '\\' << c;
+            else if (static_cast<unsigned char>(c) >= 0x20) stream << c;
+        }
+        stream << '"';
+    }
+
+    /** \brief Write the results as JSON, for comparing them over time. */
+    inline void write_json(const std::string& path, const std::string& benchmark, const std::vector<Result>& results)
+    {
+        std::ofstream stream(path);
+        if (!stream) throw IOException("Failed to open the JSON file");
+        char number[64];
+        stream << "{\n  \"benchmark\": ";
+        write_json_string(stream, benchmark);
+        stream << ",\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& result = results[i];
+            stream << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+            write_json_string(stream, result.name);
+            stream << ", \"shape\": ";
+            write_json_string(stream, result.shape);
+            stream << ", \"threads\": " << result.threads << ", \"iterations\": " << result.iterations;
+            std::snprintf(number, sizeof(number), ", \"seconds\": %.9g", result.seconds);
+            stream << number;
+            std::snprintf(number, sizeof(number), ", \"gflops\": %.6g", result.flops / result.seconds / 1e9);
+            stream << number;
+            std::snprintf(number, sizeof(number), ", \"gbps\": %.6g}", result.bytes / result.seconds / 1e9);
+            stream << number;
+        }
+        stream << "\n  ]\n}\n";
+        if (!stream) throw IOException("Failed to write the JSON file");
+    }
+}
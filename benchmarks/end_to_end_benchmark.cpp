@@ -0,0 +1,348 @@
+// End-to-end benchmark of training and inference on reference models.
+//
+// Usage: end_to_end_benchmark [--json PATH] [--filter TEXT] [--threads N[,N...]] [--batches N]
+//                             [--queries N] [--compare BASELINE] [--tolerance FRACTION] [--huge-pages]
+//
+// Two reference models are built from the layer helpers, an MLP and a small CNN, both classifying
+// synthetic 28x28 samples into 10 classes. Training is measured in samples per second through
+// Graph::optimize, and inference as latency percentiles of Graph::get_value. The samples are generated
+// from a fixed seed, so runs differ only in the initial weights and the shuffling, which don't change the
+// amount of work. With --compare, the results are checked against a baseline written by --json, and the
+// exit code is 2 if any metric regressed by more than the tolerance. --huge-pages allocates the arrays with
+// ArrayAllocator::huge_pages instead of the default allocator. A deep chain of about 10^5 small nodes is
+// also built and trained, measuring the overhead of the graph itself rather than of the kernels.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "chlorolearn/graph/graph.h"
+#include "chlorolearn/graph/operators.h"
+#include "chlorolearn/graph/optimizer.h"
+
+using namespace chloro;
+
+namespace
+{
+    constexpr size_t sample_amount = 512;
+    constexpr size_t class_amount = 10;
+    constexpr size_t batch_size = 64;
+
+    struct Options final
+    {
+        benchmark::Options common;
+        size_t batches = 8; // Timed training batches, after a warm-up batch
+        size_t queries = 500; // Timed inference queries, after as many warm-up queries as batches
+        std::string baseline_path;
+        double tolerance = 0.1;
+        bool huge_pages = false;
+    };
+
+    Options parse_options(const int argc, char** argv)
+    {
+        Options options{ benchmark::Options::parse(argc, argv) };
+        const std::vector<std::string>& rest = options.common.rest;
+        for (size_t i = 0; i < rest.size(); i++)
+        {
+            const bool has_value = i + 1 < rest.size();
+            if (rest[i] == "--batches" && has_value) options.batches = size_t(std::stoull(rest[++i]));
+            else if (rest[i] == "--queries" && has_value) options.queries = size_t(std::stoull(rest[++i]));
+            else if (rest[i] == "--compare" && has_value) options.baseline_path = rest[++i];
+            else if (rest[i] == "--tolerance" && has_value) options.tolerance = std::stod(rest[++i]);
+            else if (rest[i] == "--huge-pages") options.huge_pages = true;
+            else std::cerr << "Ignoring unknown argument " << rest[i] << '\n';
+        }
+        if (options.batches == 0 || options.queries == 0)
+            throw IllegalArgumentException("At least one batch and one query are needed");
+        return options;
+    }
+
+    // A measured quantity, compared with the baseline by its name and thread count
+    struct Metric final
+    {
+        std::string name;
+        size_t threads = 0;
+        std::string unit;
+        double value = 0.0;
+        bool higher_is_better = true;
+
+        std::string key() const { return name + "@" + std::to_string(threads); }
+    };
+
+    struct Dataset final
+    {
+        std::vector<Array<double>> samples;
+        std::vector<Array<double>> labels;
+    };
+
+    // Every class has a random prototype, and the samples are noisy copies of the prototypes
+    Dataset make_dataset(const ArrayShape& shape)
+    {
+        std::mt19937 generator{ 20240601 };
+        std::normal_distribution<double> distribution;
+        std::vector<Array<double>> prototypes;
+        for (size_t i = 0; i < class_amount; i++)
+        {
+            Array<double> prototype = Array<double>::zeros(shape);
+            for (size_t j = 0; j < prototype.size(); j++) prototype[j] = distribution(generator);
+            prototypes.push_back(std::move(prototype));
+        }
+        Dataset dataset;
+        for (size_t i = 0; i < sample_amount; i++)
+        {
+            const size_t label = i % class_amount;
+            Array<double> sample = prototypes[label];
+            for (size_t j = 0; j < sample.size(); j++) sample[j] += 0.5 * distribution(generator);
+            dataset.samples.push_back(std::move(sample));
+            dataset.labels.emplace_back(double(label));
+        }
+        return dataset;
+    }
+
+    struct Model final
+    {
+        const char* name;
+        ArrayShape input_shape;
+        // Build the network from the input node, returning the output of the last layer before the softmax
+        std::function<NodeRef(Graph&, NodeRef)> build;
+    };
+
+    const std::vector<Model>& models()
+    {
+        static const std::vector<Model> result{
+            { "mlp", { 784, 1 }, [](Graph& graph, const NodeRef input)
+                {
+                    NodeRef hidden = layers::dense_layer(graph, input, 128, operators::relu);
+                    hidden = layers::dense_layer(graph, hidden, 64, operators::relu);
+                    return layers::dense_layer(graph, hidden, class_amount);
+                } },
+            { "cnn", { 28, 28, 1 }, [](Graph& graph, const NodeRef input)
+                {
+                    NodeRef features = layers::convolutional_2d(graph, input, 3, 8, 1, operators::relu);
+                    features = graph.add_operator(operators::max_pool_2d(features, 2));
+                    features = layers::convolutional_2d(graph, features, 3, 16, 1, operators::relu);
+                    features = graph.add_operator(operators::max_pool_2d(features, 2));
+                    features = graph.add_operator(operators::flatten(features));
+                    return layers::dense_layer(graph, features, class_amount);
+                } }
+        };
+        return result;
+    }
+
+    double percentile(const std::vector<double>& sorted, const double fraction)
+    {
+        const size_t index = std::min(sorted.size() - 1, size_t(fraction * double(sorted.size())));
+        return sorted[index];
+    }
+
+    void run_model(const Model& model, const Options& options, std::vector<Metric>& metrics)
+    {
+        using Clock = std::chrono::steady_clock;
+        const Dataset dataset = make_dataset(model.input_shape);
+        Graph graph;
+        Node& input = graph.add_input(model.input_shape);
+        Node& label = graph.add_input();
+        const NodeRef logits = model.build(graph, input);
+        Node& output = graph.add_operator(operators::softmax(logits));
+        Node& loss = graph.add_operator(operators::categorical_cross_entropy(NodeRef(output), NodeRef(label)));
+        const size_t threads = thread_count();
+        const std::string name = model.name;
+
+        if (options.common.selected(name + "/train"))
+        {
+            std::vector<double> batch_seconds;
+            graph.optimize(loss, { { input, dataset.samples }, { label, dataset.labels } }, optimizers::sgd(0.01),
+                batch_size, [&](const double seconds)
+                {
+                    batch_seconds.push_back(seconds);
+                    if (batch_seconds.size() > options.batches) graph.stop_optimizing();
+                });
+            // The first batch warms up the caches and the allocations, and is left out
+            batch_seconds.erase(batch_seconds.begin());
+            std::sort(batch_seconds.begin(), batch_seconds.end());
+            metrics.push_back({ name + "/train", threads, "samples/s", double(batch_size) / percentile(batch_seconds, 0.5) });
+        }
+
+        if (options.common.selected(name + "/infer"))
+        {
+            std::vector<double> latencies;
+            latencies.reserve(options.queries);
+            for (size_t i = 0; i < options.batches + options.queries; i++)
+            {
+                const Array<double>& sample = dataset.samples[i % sample_amount];
+                const Clock::time_point start = Clock::now();
+                benchmark::keep(graph.get_value(output, { { input, sample } }));
+                const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                if (i >= options.batches) latencies.push_back(seconds);
+            }
+            std::sort(latencies.begin(), latencies.end());
+            double total = 0.0;
+            for (const double seconds : latencies) total += seconds;
+            metrics.push_back({ name + "/infer", threads, "samples/s", double(latencies.size()) / total });
+            metrics.push_back({ name + "/infer_p50", threads, "us", percentile(latencies, 0.5) * 1e6, false });
+            metrics.push_back({ name + "/infer_p90", threads, "us", percentile(latencies, 0.9) * 1e6, false });
+            metrics.push_back({ name + "/infer_p99", threads, "us", percentile(latencies, 0.99) * 1e6, false });
+        }
+    }
+
+    // Residual blocks h + h * w sharing one variable, so that the graph has 10^5 nodes but little arithmetic
+    void run_deep(const Options& options, std::vector<Metric>& metrics)
+    {
+        using Clock = std::chrono::steady_clock;
+        constexpr size_t block_amount = 50000;
+        const size_t threads = thread_count();
+        const bool build_selected = options.common.selected("deep/build");
+        if (!build_selected && !options.common.selected("deep/step")) return;
+        const Clock::time_point build_start = Clock::now();
+        Graph graph;
+        Node& input = graph.add_input({ 16 });
+        Node& weight = graph.add_variable({ 16 });
+        NodeRef hidden = input;
+        for (size_t i = 0; i < block_amount; i++)
+            hidden = graph.add_operator(operators::add(hidden, operators::multiply(hidden, NodeRef(weight))));
+        Node& loss = graph.add_operator(operators::sum(hidden));
+        const double build_seconds = std::chrono::duration<double>(Clock::now() - build_start).count();
+        if (build_selected)
+            metrics.push_back({ "deep/build", threads, "nodes/s", double(graph.node_count()) / build_seconds });
+        if (!options.common.selected("deep/step")) return;
+        const Array<double> sample = Array<double>::repeats(0.5, { 16 });
+        std::vector<double> step_seconds;
+        for (size_t i = 0; i <= options.batches; i++)
+        {
+            const Clock::time_point start = Clock::now();
+            graph.optimize_once(loss, { { input, sample } }, optimizers::sgd(1e-9));
+            // The first step warms up the caches and the allocations, and is left out
+            if (i > 0) step_seconds.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+        }
+        std::sort(step_seconds.begin(), step_seconds.end());
+        metrics.push_back({ "deep/step", threads, "ms", percentile(step_seconds, 0.5) * 1e3, false });
+    }
+
+    void write_metric(std::ostream& stream, const Metric& metric)
+    {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-24.24s %7zu %14.3f %-10s\n", metric.name.c_str(), metric.threads,
+            metric.value, metric.unit.c_str());
+        stream << line;
+    }
+
+    // Every metric is written on its own line, which is what read_metrics relies on
+    void write_metrics(const std::string& path, const std::vector<Metric>& metrics)
+    {
+        std::ofstream stream(path);
+        if (!stream) throw IOException("Failed to open the JSON file");
+        char number[64];
+        stream << "{\n  \"benchmark\": \"end_to_end\",\n  \"metrics\": [";
+        for (size_t i = 0; i < metrics.size(); i++)
+        {
+            const Metric& metric = metrics[i];
+            stream << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+            benchmark::write_json_string(stream, metric.name);
+            stream << ", \"threads\": " << metric.threads << ", \"unit\": ";
+            benchmark::write_json_string(stream, metric.unit);
+            std::snprintf(number, sizeof(number), ", \"value\": %.9g", metric.value);
+            stream << number << ", \"higher_is_better\": " << (metric.higher_is_better ? "true" : "false") << '}';
+        }
+        stream << "\n  ]\n}\n";
+        if (!stream) throw IOException("Failed to write the JSON file");
+    }
+
+    std::map<std::string, Metric> read_metrics(const std::string& path)
+    {
+        std::ifstream stream(path);
+        if (!stream) throw IOException("Failed to open the baseline file");
+        const auto field = [](const std::string& line, const std::string& key) -> const char*
+        {
+            const size_t position = line.find("\"" + key + "\": ");
+            return position == std::string::npos ? nullptr : line.c_str() + position + key.size() + 4;
+        };
+        std::map<std::string, Metric> result;
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            const char* name = field(line, "name");
+            const char* threads = field(line, "threads");
+            const char* value = field(line, "value");
+            const char* higher = field(line, "higher_is_better");
+            if (!name || !threads || !value || !higher || *name != '"') continue;
+            Metric metric;
+            metric.name.assign(name + 1, std::strchr(name + 1, '"'));
+            metric.threads = size_t(std::strtoull(threads, nullptr, 10));
+            metric.value = std::strtod(value, nullptr);
+            metric.higher_is_better = std::strncmp(higher, "true", 4) == 0;
+            result.emplace(metric.key(), std::move(metric));
+        }
+        return result;
+    }
+
+    // Print the change of every metric against the baseline, returning whether any regressed
+    bool compare(const std::vector<Metric>& metrics, const std::map<std::string, Metric>& baseline,
+        const double tolerance)
+    {
+        bool regressed = false;
+        char line[192];
+        std::snprintf(line, sizeof(line), "\n%-24s %7s %14s %14s %9s\n", "metric", "threads", "baseline", "current",
+            "change");
+        std::cout << line;
+        for (const Metric& metric : metrics)
+        {
+            const auto found = baseline.find(metric.key());
+            if (found == baseline.end() || found->second.value <= 0.0)
+            {
+                std::snprintf(line, sizeof(line), "%-24.24s %7zu %14s %14.3f %9s\n", metric.name.c_str(),
+                    metric.threads, "-", metric.value, "new");
+                std::cout << line;
+                continue;
+            }
+            const double base = found->second.value;
+            const double change = (metric.value - base) / base;
+            const bool worse = metric.higher_is_better ? change < -tolerance : change > tolerance;
+            regressed = regressed || worse;
+            std::snprintf(line, sizeof(line), "%-24.24s %7zu %14.3f %14.3f %+8.1f%%%s\n", metric.name.c_str(),
+                metric.threads, base, metric.value, change * 100, worse ? "  REGRESSION" : "");
+            std::cout << line;
+        }
+        return regressed;
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    try
+    {
+        const Options options = parse_options(argc, argv);
+        if (options.huge_pages) ArrayAllocator::set_default(ArrayAllocator::huge_pages());
+        std::vector<Metric> metrics;
+        std::printf("%-24s %7s %14s %-10s\n", "metric", "threads", "value", "unit");
+        for (const size_t threads : options.common.threads)
+        {
+            set_thread_count(threads);
+            for (const Model& model : models())
+            {
+                const size_t first = metrics.size();
+                run_model(model, options, metrics);
+                for (size_t i = first; i < metrics.size(); i++) write_metric(std::cout, metrics[i]);
+            }
+            const size_t first = metrics.size();
+            run_deep(options, metrics);
+            for (size_t i = first; i < metrics.size(); i++) write_metric(std::cout, metrics[i]);
+        }
+        if (!options.common.json_path.empty()) write_metrics(options.common.json_path, metrics);
+        if (!options.baseline_path.empty() && compare(metrics, read_metrics(options.baseline_path), options.tolerance))
+            return 2;
+        return 0;
+    }
+    catch (const std::exception& exception)
+    {
+        std::cerr << exception.what() << '\n';
+        return 1;
+    }
+}
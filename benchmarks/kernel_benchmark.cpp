@@ -0,0 +1,191 @@
+// Microbenchmarks of the kernels behind the operators and the optimizers.
+//
+// Usage: kernel_benchmark [--json PATH] [--filter TEXT] [--min-time SECONDS] [--threads N[,N...]]
+//
+// Every case is timed as the median of several samples, and its work is estimated the same way as the
+// profiler does (see chloro::estimate_cost), so the rates here are comparable with the profiler report.
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "chlorolearn/graph/execution_plan.h"
+#include "chlorolearn/graph/graph.h"
+#include "chlorolearn/graph/operators.h"
+#include "chlorolearn/graph/optimizer.h"
+#include "chlorolearn/graph/profiler.h"
+
+using namespace chloro;
+
+namespace
+{
+    constexpr double word = sizeof(double);
+
+    std::string shape_string(const ArrayShape& shape)
+    {
+        std::string result;
+        for (const size_t length : shape)
+            result += (result.empty() ? "" : "x") + std::to_string(length);
+        return result;
+    }
+
+    std::string shapes_string(const std::vector<ArrayShape>& shapes)
+    {
+        std::string result;
+        for (const ArrayShape& shape : shapes)
+            result += (result.empty() ? "" : ",") + shape_string(shape);
+        return result;
+    }
+
+    class Runner final
+    {
+    private:
+        const benchmark::Options& options_;
+        std::vector<benchmark::Result> results_;
+    public:
+        explicit Runner(const benchmark::Options& options) :options_(options) {}
+
+        template <typename Func>
+        void run(const std::string& name, const std::string& shape, const double flops, const double bytes,
+            Func&& func)
+        {
+            if (!options_.selected(name)) return;
+            results_.push_back(benchmark::measure(name, shape, flops, bytes, options_.min_time, func));
+            benchmark::write_row(std::cout, &results_.back());
+        }
+
+        const std::vector<benchmark::Result>& results() const { return results_; }
+    };
+
+    void array_cases(Runner& runner)
+    {
+        for (const size_t size : { size_t(1) << 10, size_t(1) << 16, size_t(1) << 20 })
+        {
+            const ArrayShape shape{ size };
+            const std::string text = shape_string(shape);
+            const double n = double(size);
+            const Array<double> left = Array<double>::random(shape);
+            const Array<double> right = Array<double>::random(shape);
+            Array<double> target = Array<double>::random(shape);
+            runner.run("array/add", text, n, 3 * n * word, [&] { benchmark::keep(left + right); });
+            runner.run("array/multiply", text, n, 3 * n * word, [&] { benchmark::keep(left * right); });
+            runner.run("array/add_assign", text, n, 3 * n * word, [&] { benchmark::keep(target += right); });
+            runner.run("array/apply", text, n, 2 * n * word,
+                [&] { benchmark::keep(left.apply([](const double v) { return v * 0.5 + 1.0; })); });
+            runner.run("array/sum", text, n, n * word, [&] { benchmark::keep(left.sum()); });
+        }
+    }
+
+    // Benchmark an operator on random variables, both evaluated through an execution plan and trained
+    // through a full forward and backward step
+    void operator_case(Runner& runner, const std::string& kind, const std::vector<double>& attributes,
+        const std::vector<ArrayShape>& shapes, const std::function<Operand(std::vector<NodeRef>&)>& build)
+    {
+        const std::string forward_name = "op/" + kind + "/forward";
+        const std::string step_name = "op/" + kind + "/step";
+        Graph graph;
+        std::vector<NodeRef> variables;
+        for (const ArrayShape& shape : shapes)
+        {
+            Node& variable = graph.add_variable(shape);
+            graph.set_variable(variable, Array<double>::random(shape));
+            variables.emplace_back(variable);
+        }
+        Node& result = graph.add_operator(build(variables));
+        Node& target = graph.add_operator(operators::sum(NodeRef(result)));
+        const ArrayShape& shape = result.shape();
+        const std::array<ProfileCost, 2> costs = estimate_cost({ kind, attributes }, shapes, shape);
+        const std::string text = shapes_string(shapes);
+        ExecutionPlan plan(result);
+        runner.run(forward_name, text, costs[0].flops, costs[0].bytes, [&] { benchmark::keep(plan.run()); });
+        const Optimizer none = [](Array<double>&, Array<double>&) {};
+        runner.run(step_name, text, costs[0].flops + costs[1].flops, costs[0].bytes + costs[1].bytes,
+            [&] { graph.optimize_once(target, {}, none); });
+    }
+
+    void operator_cases(Runner& runner)
+    {
+        for (const size_t n : { 32, 128, 256 })
+            operator_case(runner, "matrix_multiply", {}, { { n, n }, { n, n } },
+                [](std::vector<NodeRef>& v) { return operators::matrix_multiply(v[0], v[1]); });
+        const std::vector<std::vector<ArrayShape>> convolutions{
+            { { 28, 28, 1 }, { 16, 3, 3, 1 } },
+            { { 32, 32, 16 }, { 32, 3, 3, 16 } },
+            { { 64, 64, 3 }, { 16, 5, 5, 3 } }
+        };
+        for (const std::vector<ArrayShape>& shapes : convolutions)
+            operator_case(runner, "convolution_2d_with_padding", { 1, 1 }, shapes,
+                [](std::vector<NodeRef>& v) { return operators::convolution_2d_with_padding(v[0], v[1]); });
+        for (const ArrayShape& shape : { ArrayShape{ 28, 28, 16 }, ArrayShape{ 64, 64, 32 } })
+            operator_case(runner, "max_pool_2d", { 2, 2, 2, 2 }, { shape },
+                [](std::vector<NodeRef>& v) { return operators::max_pool_2d(v[0], 2); });
+        for (const size_t n : { 10, 100, 1000 })
+            operator_case(runner, "softmax", {}, { { n, 1 } },
+                [](std::vector<NodeRef>& v) { return operators::softmax(v[0]); });
+        for (const size_t n : { size_t(1) << 10, size_t(1) << 16, size_t(1) << 20 })
+            operator_case(runner, "dropout", { 0.5 }, { { n } },
+                [](std::vector<NodeRef>& v) { return operators::dropout(v[0], 0.5); });
+    }
+
+    void optimizer_cases(Runner& runner)
+    {
+        // Flops and words moved per parameter, counting the value, the gradient and the states
+        struct OptimizerCase
+        {
+            const char* name;
+            std::function<Optimizer()> make;
+            double flops;
+            double words;
+        };
+        const std::vector<OptimizerCase> cases{
+            { "sgd", [] { return optimizers::sgd(); }, 2, 3 },
+            { "momentum", [] { return optimizers::momentum(); }, 4, 5 },
+            { "adam", [] { return optimizers::adam(); }, 12, 7 },
+            { "adamw", [] { return optimizers::adamw(); }, 14, 7 }
+        };
+        for (const OptimizerCase& optimizer_case : cases)
+            for (const size_t size : { size_t(1) << 10, size_t(1) << 16, size_t(1) << 20 })
+            {
+                const ArrayShape shape{ size };
+                Array<double> value = Array<double>::random(shape);
+                const Array<double> gradient = Array<double>::random(shape, 0.0, 1e-3);
+                Array<double> scratch = gradient;
+                const Optimizer optimizer = optimizer_case.make();
+                const double n = double(size);
+                // The gradient is restored before every step since optimizers may overwrite it, which is
+                // part of the timing but not of the counted work
+                runner.run(std::string("optimizer/") + optimizer_case.name, shape_string(shape),
+                    optimizer_case.flops * n, optimizer_case.words * n * word,
+                    [&] { scratch.assign(gradient); optimizer(value, scratch); });
+            }
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    try
+    {
+        const benchmark::Options options = benchmark::Options::parse(argc, argv);
+        for (const std::string& argument : options.rest)
+            std::cerr << "Ignoring unknown argument " << argument << '\n';
+        benchmark::write_row(std::cout, nullptr);
+        Runner runner(options);
+        for (const size_t threads : options.threads)
+        {
+            set_thread_count(threads);
+            array_cases(runner);
+            operator_cases(runner);
+            optimizer_cases(runner);
+        }
+        if (!options.json_path.empty())
+            benchmark::write_json(options.json_path, "kernel", runner.results());
+        return 0;
+    }
+    catch (const std::exception& exception)
+    {
+        std::cerr << exception.what() << '\n';
+        return 1;
+    }
+}
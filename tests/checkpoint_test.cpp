@@ -0,0 +1,125 @@
+// Checks that checkpoint files with corrupt sizes in their header or index are rejected when they're
+// opened, instead of being read out of bounds.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "chlorolearn/utility/checkpoint.h"
+#include "chlorolearn/utility/crc32.h"
+
+using namespace chloro;
+
+namespace
+{
+    int failures = 0;
+
+    void check(const bool condition, const char* message)
+    {
+        if (condition) return;
+        std::cerr << "FAILED: " << message << '\n';
+        failures++;
+    }
+
+    bool rejected(const std::string& path)
+    {
+        try
+        {
+            Checkpoint checkpoint(path, false);
+            return false;
+        }
+        catch (const IOException&)
+        {
+            return true;
+        }
+    }
+
+    std::vector<char> read_file(const std::string& path)
+    {
+        std::ifstream stream(path, std::ios::binary);
+        return { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+    }
+
+    void write_file(const std::string& path, const std::vector<char>& bytes)
+    {
+        std::ofstream stream(path, std::ios::binary);
+        stream.write(bytes.data(), std::streamsize(bytes.size()));
+    }
+
+    template <typename T>
+    void patch(std::vector<char>& bytes, const size_t offset, const T value)
+    {
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    // The header is 8 bytes of magic, the version, the entry count, the index size and the index checksum
+    constexpr size_t count_offset = 12;
+    constexpr size_t index_size_offset = 16;
+    constexpr size_t checksum_offset = 24;
+    constexpr size_t index_offset = 28;
+
+    // Patch a value in the index and update the checksum, so that only the sizes are corrupt
+    template <typename T>
+    void patch_index(std::vector<char>& bytes, const size_t offset, const T value)
+    {
+        patch(bytes, offset, value);
+        uint64_t index_size;
+        std::memcpy(&index_size, bytes.data() + index_size_offset, sizeof(index_size));
+        patch(bytes, checksum_offset, crc32(bytes.data() + index_offset, size_t(index_size)));
+    }
+}
+
+int main()
+{
+    const std::vector<double> values{ 0, 1, 2, 3, 4, 5 };
+    const std::string path = "checkpoint_test.ckpt";
+    write_checkpoint(path, { { "w", { 2, 3 }, values.data() } });
+    const std::vector<char> bytes = read_file(path);
+
+    {
+        const Checkpoint checkpoint(path);
+        check(checkpoint.read("w")[5] == 5.0, "an intact checkpoint is read back");
+    }
+
+    // The entry "w" is a 4 byte name length, the name, the dimension, the lengths, the precision, the
+    // offset, the size and the checksum of the values
+    constexpr size_t dimension_offset = index_offset + 4 + 1;
+    constexpr size_t first_length_offset = dimension_offset + 8;
+    constexpr size_t data_offset = first_length_offset + 16 + 4;
+    constexpr size_t bytes_offset = data_offset + 8;
+
+    std::vector<char> corrupt = bytes;
+    patch(corrupt, index_size_offset, uint64_t(-16));
+    write_file(path, corrupt);
+    check(rejected(path), "an index size wrapping around the file size is rejected");
+
+    corrupt = bytes;
+    patch(corrupt, count_offset, uint32_t(-1));
+    write_file(path, corrupt);
+    check(rejected(path), "an entry count larger than the index is rejected");
+
+    corrupt = bytes;
+    patch_index(corrupt, dimension_offset, uint64_t(9));
+    write_file(path, corrupt);
+    check(rejected(path), "an entry of too many dimensions is rejected");
+
+    corrupt = bytes;
+    patch_index(corrupt, first_length_offset, uint64_t(1) << 32);
+    patch_index(corrupt, first_length_offset + 8, uint64_t(1) << 32);
+    patch_index(corrupt, bytes_offset, uint64_t(0));
+    write_file(path, corrupt);
+    check(rejected(path), "a shape whose size wraps around is rejected");
+
+    corrupt = bytes;
+    patch_index(corrupt, data_offset, uint64_t(-64));
+    write_file(path, corrupt);
+    check(rejected(path), "an offset wrapping around the file size is rejected");
+
+    std::remove(path.c_str());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+// Checks that IDX files whose headers describe more data than the file holds, or more dimensions than
+// an array can have, are rejected when they're mapped.
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "chlorolearn/utility/idx_file.h"
+
+using namespace chloro;
+
+namespace
+{
+    int failures = 0;
+
+    void check(const bool condition, const char* message)
+    {
+        if (condition) return;
+        std::cerr << "FAILED: " << message << '\n';
+        failures++;
+    }
+
+    bool rejected(const std::string& path)
+    {
+        try
+        {
+            IdxFile file(path);
+            return false;
+        }
+        catch (const IOException&)
+        {
+            return true;
+        }
+    }
+
+    // Write an IDX file of unsigned bytes with the given lengths and values
+    void write_idx(const std::string& path, const std::vector<uint32_t>& lengths, const std::vector<uint8_t>& values)
+    {
+        std::ofstream stream(path, std::ios::binary);
+        const char type[4] = { 0, 0, 0x08, char(lengths.size()) };
+        stream.write(type, sizeof(type));
+        for (const uint32_t length : lengths)
+        {
+            const char bytes[4] = { char(length >> 24), char(length >> 16), char(length >> 8), char(length) };
+            stream.write(bytes, sizeof(bytes));
+        }
+        stream.write(reinterpret_cast<const char*>(values.data()), std::streamsize(values.size()));
+    }
+}
+
+int main()
+{
+    const std::string path = "idx_test.idx";
+
+    write_idx(path, { 2, 2, 2 }, { 0, 1, 2, 3, 4, 5, 6, 7 });
+    {
+        const IdxFile file(path);
+        check(file.size() == 2 && file.sample_data(1)[3] == 7, "an intact IDX file is read back");
+    }
+
+    write_idx(path, { 2, 2, 2 }, { 0, 1, 2, 3, 4, 5, 6 });
+    check(rejected(path), "an IDX file missing a value is rejected");
+
+    write_idx(path, { uint32_t(1) << 20, uint32_t(1) << 22, uint32_t(1) << 22 }, std::vector<uint8_t>(64));
+    check(rejected(path), "an IDX file whose size wraps around is rejected");
+
+    write_idx(path, std::vector<uint32_t>(10, 1), { 0 });
+    check(rejected(path), "an IDX file of too many dimensions is rejected");
+
+    std::remove(path.c_str());
+    return failures == 0 ? 0 : 1;
+}
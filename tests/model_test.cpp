@@ -0,0 +1,104 @@
+// Checks that model files with corrupt counts in their description are rejected with an IOException,
+// instead of attempting huge allocations, and that the graph is left empty.
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "chlorolearn/graph/graph.h"
+#include "chlorolearn/graph/operators.h"
+#include "chlorolearn/utility/binary_io.h"
+#include "chlorolearn/utility/checkpoint.h"
+
+using namespace chloro;
+using namespace chloro::operators;
+
+namespace
+{
+    int failures = 0;
+
+    void check(const bool condition, const char* message)
+    {
+        if (condition) return;
+        std::cerr << "FAILED: " << message << '\n';
+        failures++;
+    }
+
+    bool rejected(const std::string& path)
+    {
+        Graph graph;
+        try
+        {
+            graph.load_model(path);
+            return false;
+        }
+        catch (const IOException&)
+        {
+            return graph.node_count() == 0;
+        }
+    }
+
+    // Write a model file without arrays, described by the bytes of a writer
+    void write_model(const std::string& path, const ByteWriter& writer)
+    {
+        const std::vector<char>& bytes = writer.bytes();
+        write_checkpoint(path, {}, Precision::float64, std::string(bytes.begin(), bytes.end()));
+    }
+
+    // The model description starts with the version and the node count, then every node starts with its type
+    constexpr uint32_t model_version = 1;
+    constexpr uint8_t input_type = 0;
+    constexpr uint8_t operator_type = 3;
+}
+
+int main()
+{
+    const std::string path = "model_test.model";
+
+    {
+        Graph graph;
+        Node& x = graph.add_input({ 2 });
+        graph.add_operator(sum(NodeRef(x)));
+        graph.save_model(path);
+        Graph loaded;
+        loaded.load_model(path);
+        check(loaded.node_count() == 2, "an intact model is loaded");
+    }
+
+    ByteWriter writer;
+    writer.write(model_version);
+    writer.write(uint64_t(-1));
+    write_model(path, writer);
+    check(rejected(path), "a node count larger than the model description is rejected");
+
+    writer = ByteWriter();
+    writer.write(model_version);
+    writer.write(uint64_t(1));
+    writer.write(input_type);
+    writer.write(uint64_t(9));
+    write_model(path, writer);
+    check(rejected(path), "an input of too many dimensions is rejected");
+
+    writer = ByteWriter();
+    writer.write(model_version);
+    writer.write(uint64_t(1));
+    writer.write(operator_type);
+    writer.write_string("sum");
+    writer.write(uint64_t(1) << 61);
+    write_model(path, writer);
+    check(rejected(path), "an attribute count larger than the model description is rejected");
+
+    writer = ByteWriter();
+    writer.write(model_version);
+    writer.write(uint64_t(1));
+    writer.write(operator_type);
+    writer.write_string("sum");
+    writer.write(uint64_t(0));
+    writer.write(uint64_t(-1));
+    write_model(path, writer);
+    check(rejected(path), "an operand count larger than the model description is rejected");
+
+    std::remove(path.c_str());
+    return failures == 0 ? 0 : 1;
+}
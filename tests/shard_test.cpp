@@ -0,0 +1,107 @@
+// Checks that shard files with truncated values or corrupt headers are rejected when they're mapped,
+// instead of being read out of bounds when samples are fetched.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "chlorolearn/utility/data_source.h"
+
+using namespace chloro;
+
+namespace
+{
+    int failures = 0;
+
+    void check(const bool condition, const char* message)
+    {
+        if (condition) return;
+        std::cerr << "FAILED: " << message << '\n';
+        failures++;
+    }
+
+    bool rejected(const std::string& path)
+    {
+        try
+        {
+            ShardDataSource source({ path });
+            return false;
+        }
+        catch (const IOException&)
+        {
+            return true;
+        }
+    }
+
+    std::vector<char> read_file(const std::string& path)
+    {
+        std::ifstream stream(path, std::ios::binary);
+        return { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+    }
+
+    void write_file(const std::string& path, const std::vector<char>& bytes)
+    {
+        std::ofstream stream(path, std::ios::binary);
+        stream.write(bytes.data(), std::streamsize(bytes.size()));
+    }
+
+    template <typename T>
+    void patch(std::vector<char>& bytes, const size_t offset, const T value)
+    {
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+}
+
+int main()
+{
+    // 3 samples of one field of shape { 5 }, 120 bytes of values which don't end at the 64 byte alignment
+    DataValues pack;
+    for (size_t i = 0; i < 3; i++) pack.push_back(Array<double>::repeats(double(i), { 5 }));
+    const std::string path = "shard_test.shard";
+    write_shard(path, PackDataSource({ pack }));
+    const std::vector<char> bytes = read_file(path);
+
+    {
+        const ShardDataSource source({ path });
+        Array<double> value;
+        source.fetch(2, 0, value);
+        check(source.size() == 3 && value[4] == 2.0, "an intact shard is read back");
+    }
+
+    // The header is 8 bytes of magic, the version, the field count, the sample count, then the shapes
+    constexpr size_t field_count_offset = 12;
+    constexpr size_t sample_count_offset = 16;
+    constexpr size_t first_length_offset = 32;
+    const size_t values_end = bytes.size() - 8; // The values end 8 bytes before the padding does
+
+    std::vector<char> truncated(bytes.begin(), bytes.begin() + std::ptrdiff_t(values_end - 8));
+    write_file(path, truncated);
+    check(rejected(path), "a shard cut short by less than the alignment is rejected");
+
+    std::vector<char> unpadded(bytes.begin(), bytes.begin() + std::ptrdiff_t(values_end));
+    write_file(path, unpadded);
+    check(!rejected(path), "a shard missing only the padding after the values is accepted");
+
+    std::vector<char> corrupt = bytes;
+    patch(corrupt, sample_count_offset, uint64_t(1) << 62);
+    write_file(path, corrupt);
+    check(rejected(path), "a sample count overflowing the size of the values is rejected");
+
+    corrupt = bytes;
+    patch(corrupt, first_length_offset, uint64_t(-1));
+    write_file(path, corrupt);
+    check(rejected(path), "a shape overflowing the size of the values is rejected");
+
+    corrupt = bytes;
+    patch(corrupt, field_count_offset, uint32_t(-1));
+    write_file(path, corrupt);
+    check(rejected(path), "a field count larger than the header is rejected");
+
+    std::remove(path.c_str());
+    return failures == 0 ? 0 : 1;
+}